@@ -40,6 +40,9 @@ typedef union { float ptr[4]; float vex __attribute__((vector_size(16))); } vec4
 typedef union { float ptr[16]; float vex __attribute__((vector_size(64))); } mat4f;
 typedef union { double ptr[4]; double vex __attribute__((vector_size(32))); } vec4d;
 typedef union { double ptr[16]; double vex __attribute__((vector_size(128))); } mat4d;
+// affine matrices, the implicit last row is 0 0 0 1
+typedef union { float ptr[12]; vec4f row[3]; } aff34f;
+typedef union { double ptr[12]; vec4d row[3]; } aff34d;
 
 #ifdef __clang__
 #define vector_shuffle __builtin_shufflevector
@@ -68,6 +71,33 @@ typedef union { double ptr[16]; double vex __attribute__((vector_size(128))); }
   printf("\n"); \
 } while (0)
 
+// Precision of the transcendental functions used by mat4d_rotate,
+// mat4d_perspective and mat4d_ortho, set per thread. PRECISION_FAST is
+// within a few hundred ULPs of double, PRECISION_FASTEST keeps about 2^-27
+// relative error, plenty for results that are converted to float. sqrt and
+// 1 / sqrt have no tier, the hardware ones beat any approximation.
+enum precision {
+  PRECISION_EXACT,
+  PRECISION_FAST,
+  PRECISION_FASTEST,
+};
+
+void precision_set(enum precision p);
+
+enum precision precision_get(void);
+
+// beyond APPROX_SINCOS_MAX the argument reduction would lose bits, every
+// tier falls back to sin and cos there
+#define APPROX_SINCOS_MAX 8e5
+
+void approx_sincos(double x, double *s, double *c, enum precision p);
+
+double approx_sin(double x, enum precision p);
+
+double approx_cos(double x, enum precision p);
+
+double approx_tan(double x, enum precision p);
+
 double vec4d_sum(vec4d v);
 
 double vec4d_dot_product(vec4d u, vec4d v);
@@ -98,6 +128,8 @@ mat4d mat4d_multiply(mat4d m, mat4d n);
 
 vec4d mat4d_multiply_vec4d(mat4d m, vec4d v);
 
+mat4d mat4d_inverse(mat4d m);
+
 mat4d mat4d_scale(mat4d m, double x, double y, double z);
 
 mat4d mat4d_translate(mat4d m, double x, double y, double z);
@@ -114,10 +146,42 @@ mat4d mat4d_ortho(double fov, double aspect, double n, double f);
 
 mat4d mat4d_look_at(vec4d eye, vec4d center, vec4d up);
 
+vec4d mat4d_projection_center(mat4d m);
+
 mat4f mat4d_to_mat4f(mat4d m);
 
 bool mat4d_equal(mat4d m, mat4d n);
 
+aff34d aff34d_identity(void);
+
+aff34d aff34d_from_mat4d(mat4d m);
+
+mat4d aff34d_to_mat4d(aff34d a);
+
+aff34f aff34d_to_aff34f(aff34d a);
+
+aff34d aff34d_multiply(aff34d a, aff34d b);
+
+vec4d aff34d_transform_point(aff34d a, vec4d p);
+
+vec4d aff34d_transform_direction(aff34d a, vec4d d);
+
+aff34d aff34d_inverse(aff34d a);
+
+aff34d aff34d_scale(aff34d a, double x, double y, double z);
+
+aff34d aff34d_translate(aff34d a, double x, double y, double z);
+
+aff34d aff34d_rotate(aff34d a, vec4d axis, double degree);
+
+mat4f aff34f_to_mat4f(aff34f a);
+
+aff34f aff34f_multiply(aff34f a, aff34f b);
+
+vec4f aff34f_transform_point(aff34f a, vec4f p);
+
+vec4f aff34f_transform_direction(aff34f a, vec4f d);
+
 #ifdef __cplusplus
 }
 #endif
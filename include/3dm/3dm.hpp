@@ -0,0 +1,234 @@
+/**
+ * 3dm - simple 3D mathematic library
+ *
+ * Copyright (C) 2013 Cedric Fung <cedric@vec.io>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *    3. Neither the name of the Cedric Fung nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+
+ * THIS SOFTWARE IS PROVIDED BY Cedric Fung "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Cedric Fung BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef _3DM_HPP
+#define _3DM_HPP
+#include <type_traits>
+#include <utility>
+#include "3dm/3dm.h"
+
+// C++17 value types over the C API. Every matrix carries the pattern of its
+// structurally non-zero elements as a template argument (bit i * 4 + j for
+// row i, column j), products are generated with only the terms where both
+// factors may be non-zero, so a chain like translate(...) * scale(...) *
+// rotate(...) * m folds into the few multiplications it really needs, and
+// chains of constexpr builders are evaluated at compile time.
+namespace m3d {
+
+constexpr unsigned MASK_IDENTITY = 0x8421;
+constexpr unsigned MASK_TRANSLATE = 0x8ca9;
+constexpr unsigned MASK_LINEAR = 0x8777;
+constexpr unsigned MASK_AFFINE = 0x8fff;
+constexpr unsigned MASK_DENSE = 0xffff;
+
+constexpr bool mask_bit(unsigned mask, int i, int j)
+{
+  return (mask >> (i * 4 + j)) & 1;
+}
+
+constexpr unsigned mask_multiply(unsigned a, unsigned b)
+{
+  unsigned r = 0;
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++) {
+      for (int k = 0; k < 4; k++) {
+        if (mask_bit(a, i, k) && mask_bit(b, k, j)) { r |= 1u << (i * 4 + j); }
+      }
+    }
+  }
+  return r;
+}
+
+struct vec4 {
+  double ptr[4];
+
+  constexpr vec4() : ptr{0, 0, 0, 0} {}
+  constexpr vec4(double x, double y, double z, double w = 0) : ptr{x, y, z, w} {}
+  vec4(vec4d v) : ptr{v.ptr[0], v.ptr[1], v.ptr[2], v.ptr[3]} {}
+
+  constexpr double operator[](int i) const { return ptr[i]; }
+
+  operator vec4d() const
+  {
+    vec4d v;
+    for (int i = 0; i < 4; i++) { v.ptr[i] = ptr[i]; }
+    return v;
+  }
+};
+
+template <unsigned M>
+struct mat4_t {
+  static constexpr unsigned mask = M;
+  double ptr[16];
+
+  constexpr mat4_t() : ptr{} {}
+
+  explicit mat4_t(mat4d m) : ptr{}
+  {
+    for (int e = 0; e < 16; e++) { ptr[e] = mask_bit(M, e / 4, e % 4) ? m.ptr[e] : 0; }
+  }
+
+  // a sparser matrix can always be used where a denser one is expected
+  template <unsigned N, typename = typename std::enable_if<(N & ~M) == 0>::type>
+  constexpr mat4_t(const mat4_t<N> &m) : ptr{}
+  {
+    for (int e = 0; e < 16; e++) { ptr[e] = m.ptr[e]; }
+  }
+
+  constexpr double operator()(int i, int j) const { return ptr[i * 4 + j]; }
+
+  operator mat4d() const
+  {
+    mat4d m;
+    for (int e = 0; e < 16; e++) { m.ptr[e] = ptr[e]; }
+    return m;
+  }
+};
+
+using mat4 = mat4_t<MASK_DENSE>;
+using affine4 = mat4_t<MASK_AFFINE>;
+
+namespace detail {
+
+template <unsigned A, unsigned B, int I, int J, int K>
+constexpr bool has_term()
+{
+  if constexpr (K == 4) {
+    return false;
+  } else {
+    return (mask_bit(A, I, K) && mask_bit(B, K, J)) || has_term<A, B, I, J, K + 1>();
+  }
+}
+
+// sum of a(I, k) * b(k, J) over the k where both may be non-zero
+template <unsigned A, unsigned B, int I, int J, int K = 0>
+constexpr double dot(const double *a, const double *b)
+{
+  if constexpr (!mask_bit(A, I, K) || !mask_bit(B, K, J)) {
+    return dot<A, B, I, J, K + 1>(a, b);
+  } else if constexpr (has_term<A, B, I, J, K + 1>()) {
+    return a[I * 4 + K] * b[K * 4 + J] + dot<A, B, I, J, K + 1>(a, b);
+  } else {
+    return a[I * 4 + K] * b[K * 4 + J];
+  }
+}
+
+template <unsigned A, unsigned B, int E>
+constexpr double element(const double *a, const double *b)
+{
+  if constexpr (has_term<A, B, E / 4, E % 4, 0>()) {
+    return dot<A, B, E / 4, E % 4>(a, b);
+  } else {
+    return 0;
+  }
+}
+
+template <unsigned A, unsigned B, int... E>
+constexpr mat4_t<mask_multiply(A, B)> multiply(const mat4_t<A> &a, const mat4_t<B> &b, std::integer_sequence<int, E...>)
+{
+  mat4_t<mask_multiply(A, B)> r;
+  ((r.ptr[E] = element<A, B, E>(a.ptr, b.ptr)), ...);
+  return r;
+}
+
+template <unsigned A, int I, int K = 0>
+constexpr double dot_vec4(const double *a, const double *v)
+{
+  if constexpr (K == 3) {
+    return mask_bit(A, I, K) ? a[I * 4 + K] * v[K] : 0;
+  } else if constexpr (!mask_bit(A, I, K)) {
+    return dot_vec4<A, I, K + 1>(a, v);
+  } else if constexpr (((A >> (I * 4 + K + 1)) & ((1u << (3 - K)) - 1)) != 0) {
+    return a[I * 4 + K] * v[K] + dot_vec4<A, I, K + 1>(a, v);
+  } else {
+    return a[I * 4 + K] * v[K];
+  }
+}
+
+}
+
+template <unsigned A, unsigned B>
+constexpr mat4_t<mask_multiply(A, B)> operator*(const mat4_t<A> &a, const mat4_t<B> &b)
+{
+  return detail::multiply(a, b, std::make_integer_sequence<int, 16>());
+}
+
+template <unsigned A>
+constexpr vec4 operator*(const mat4_t<A> &a, const vec4 &v)
+{
+  return vec4(detail::dot_vec4<A, 0>(a.ptr, v.ptr), detail::dot_vec4<A, 1>(a.ptr, v.ptr),
+      detail::dot_vec4<A, 2>(a.ptr, v.ptr), detail::dot_vec4<A, 3>(a.ptr, v.ptr));
+}
+
+constexpr mat4_t<MASK_IDENTITY> identity()
+{
+  mat4_t<MASK_IDENTITY> m;
+  m.ptr[0] = m.ptr[5] = m.ptr[10] = m.ptr[15] = 1;
+  return m;
+}
+
+constexpr mat4_t<MASK_IDENTITY> scale(double x, double y, double z)
+{
+  mat4_t<MASK_IDENTITY> m;
+  m.ptr[0] = x;
+  m.ptr[5] = y;
+  m.ptr[10] = z;
+  m.ptr[15] = 1;
+  return m;
+}
+
+constexpr mat4_t<MASK_TRANSLATE> translate(double x, double y, double z)
+{
+  mat4_t<MASK_TRANSLATE> m;
+  m.ptr[0] = m.ptr[5] = m.ptr[10] = m.ptr[15] = 1;
+  m.ptr[3] = x;
+  m.ptr[7] = y;
+  m.ptr[11] = z;
+  return m;
+}
+
+inline mat4_t<MASK_LINEAR> rotate(vec4 axis, double degree)
+{
+  return mat4_t<MASK_LINEAR>(mat4d_rotate(mat4d_identity(), axis, degree));
+}
+
+inline mat4 perspective(double fov, double aspect, double n, double f)
+{
+  return mat4(mat4d_perspective(fov, aspect, n, f));
+}
+
+inline affine4 look_at(vec4 eye, vec4 center, vec4 up)
+{
+  return affine4(mat4d_look_at(eye, center, up));
+}
+
+}
+
+#endif
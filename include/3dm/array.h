@@ -0,0 +1,91 @@
+/**
+ * 3dm - simple 3D mathematic library
+ *
+ * Copyright (C) 2013 Cedric Fung <cedric@vec.io>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *    3. Neither the name of the Cedric Fung nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+
+ * THIS SOFTWARE IS PROVIDED BY Cedric Fung "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Cedric Fung BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef _3DM_ARRAY_H
+#define _3DM_ARRAY_H
+#include "3dm/3dm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MAT4D_LANES 4
+#define MAT4F_LANES 8
+
+// Matrices are stored in blocks of LANES matrices, element e of matrix i is
+// at ptr[(i / LANES) * 16 * LANES + e * LANES + i % LANES], so every vector
+// load reads the same element of LANES different matrices.
+typedef struct {
+  double *ptr;
+  int len;
+} mat4d_array;
+
+typedef struct {
+  float *ptr;
+  int len;
+} mat4f_array;
+
+mat4d_array *mat4d_array_create(int len);
+
+void mat4d_array_destroy(mat4d_array *a);
+
+void mat4d_array_set(mat4d_array *a, int i, mat4d m);
+
+mat4d mat4d_array_get(const mat4d_array *a, int i);
+
+// r[i] = m * a[i], the work is split across threads when threads > 1,
+// false if r is shorter than a
+bool mat4d_array_multiply_mat4d(mat4d_array *r, mat4d m, const mat4d_array *a, int threads);
+
+// r[i] = a[i] * b[i], false if r or b is shorter than a
+bool mat4d_array_multiply(mat4d_array *r, const mat4d_array *a, const mat4d_array *b, int threads);
+
+mat4f_array *mat4f_array_create(int len);
+
+void mat4f_array_destroy(mat4f_array *a);
+
+void mat4f_array_set(mat4f_array *a, int i, mat4f m);
+
+mat4f mat4f_array_get(const mat4f_array *a, int i);
+
+bool mat4f_array_multiply_mat4f(mat4f_array *r, mat4f m, const mat4f_array *a, int threads);
+
+bool mat4f_array_multiply(mat4f_array *r, const mat4f_array *a, const mat4f_array *b, int threads);
+
+// dst[16 * i ..] = mat4d_to_mat4f(mat4d_transpose(src[i])) in a single pass,
+// dst needs no alignment (e.g. a mapped buffer), stream uses non-temporal
+// stores when dst allows it so large uploads don't evict the caches
+void mat4d_to_mat4f_columns(float *dst, const mat4d *src, int len, bool stream);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
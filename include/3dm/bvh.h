@@ -0,0 +1,84 @@
+/**
+ * 3dm - simple 3D mathematic library
+ *
+ * Copyright (C) 2013 Cedric Fung <cedric@vec.io>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *    3. Neither the name of the Cedric Fung nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+
+ * THIS SOFTWARE IS PROVIDED BY Cedric Fung "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Cedric Fung BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef _3DM_BVH_H
+#define _3DM_BVH_H
+#include <stdbool.h>
+#include "3dm/3dm.h"
+#include "3dm/poly.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  float min[3];
+  int start; // first triangle for leaves, right child for inner nodes
+  float max[3];
+  int count; // triangles of a leaf, 0 for inner nodes, left child is the next node
+} bvh_node_t;
+
+typedef struct {
+  bvh_node_t *nodes;
+  float *triangles; // v0, v1 - v0, v2 - v0 per triangle, in leaf order
+  int *ids; // triangle index in poly->indices / 3, in leaf order
+  int n_len; // length of nodes, 0 for a poly without triangles
+  int t_len; // number of triangles
+} bvh_t;
+
+typedef struct {
+  vec4f origin;
+  vec4f direction;
+} ray_t;
+
+typedef struct {
+  float t;
+  float u, v; // barycentric coordinates of the hit
+  int triangle; // -1 if the ray misses
+} ray_hit_t;
+
+bvh_t *bvh_create(const poly_t *poly);
+
+void bvh_destroy(bvh_t *bvh);
+
+bool bvh_intersect(const bvh_t *bvh, ray_t ray, ray_hit_t *hit);
+
+// rays are traced in packets of 4, returns the number of rays that hit
+int bvh_intersect_rays(const bvh_t *bvh, const ray_t *rays, ray_hit_t *hits, int n);
+
+// x, y are window coordinates with the origin at the top left corner,
+// inverse is the inverse of projection * view
+ray_t ray_unproject(mat4d inverse, double x, double y, double width, double height);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
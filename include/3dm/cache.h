@@ -0,0 +1,71 @@
+/**
+ * 3dm - simple 3D mathematic library
+ *
+ * Copyright (C) 2013 Cedric Fung <cedric@vec.io>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *    3. Neither the name of the Cedric Fung nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+
+ * THIS SOFTWARE IS PROVIDED BY Cedric Fung "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Cedric Fung BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef _3DM_CACHE_H
+#define _3DM_CACHE_H
+#include <stddef.h>
+#include "3dm/poly.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  long hits; // acquires served by a built or building mesh
+  long misses; // acquires that had to build
+  long waits; // hits that waited for another thread's build
+  long evictions;
+  double build_seconds; // total time spent in poly_create
+  size_t bytes; // memory held by cached meshes
+} poly_cache_stats_t;
+
+// Process wide cache of poly_create meshes keyed by type and level, the
+// meshes are shared and must not be modified. Concurrent acquires of the same
+// key wait for a single build. Returns NULL if poly_create fails.
+const poly_t *poly_cache_acquire(enum poly_type type, int level);
+
+// one release per successful acquire, returns false and changes nothing if
+// poly is not held
+bool poly_cache_release(const poly_t *poly);
+
+// unreferenced meshes are evicted least recently used first while the cache
+// holds more than budget bytes, 0 (the default) never evicts
+void poly_cache_budget(size_t budget);
+
+// evicts every unreferenced mesh
+void poly_cache_clear(void);
+
+poly_cache_stats_t poly_cache_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,87 @@
+/**
+ * 3dm - simple 3D mathematic library
+ *
+ * Copyright (C) 2013 Cedric Fung <cedric@vec.io>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *    3. Neither the name of the Cedric Fung nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+
+ * THIS SOFTWARE IS PROVIDED BY Cedric Fung "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Cedric Fung BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef _3DM_CORNER_H
+#define _3DM_CORNER_H
+#include <stdbool.h>
+#include "3dm/poly.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Corner table of a poly_t, corner c is poly->indices[c] of triangle c / 3.
+// poly_t duplicates vertices per triangle and along the texture seam, so
+// the table refers to welded vertices, the ones sharing a position. The
+// opposite of corner c is the corner facing it across the edge from
+// corner_next(c) to corner_prev(c), -1 on a border.
+typedef struct {
+  enum poly_type type;
+  int *vertices; // welded vertex of each corner
+  int *opposites; // opposite corner of each corner
+  int *corners; // a corner of each welded vertex
+  int c_len; // number of corners
+  int v_len; // number of welded vertices
+} corner_table_t;
+
+static inline int corner_next(int c) { return c % 3 == 2 ? c - 2 : c + 1; }
+
+static inline int corner_prev(int c) { return c % 3 == 0 ? c + 2 : c - 1; }
+
+// the next corner of the same vertex turning around it, -1 on a border
+static inline int corner_swing(const corner_table_t *ct, int c)
+{
+  int o = ct->opposites[corner_next(c)];
+  return o < 0 ? -1 : corner_next(o);
+}
+
+// welds vertices with a hash of their position, linear in the corners
+corner_table_t *corner_table_create(const poly_t *poly);
+
+// Follows poly_subdivide of the same levels on a POLY_ICOSAHEDRON, the
+// children of each triangle are derived from its corners and opposites,
+// so no position is read or hashed.
+bool corner_table_subdivide(corner_table_t *ct, int levels);
+
+void corner_table_destroy(corner_table_t *ct);
+
+// welded vertices around the vertex of corner c, in order, returns their
+// count, up to max are written to ring
+int corner_table_ring(const corner_table_t *ct, int c, int *ring, int max);
+
+// true if the edge facing corner c is a border or a texture seam, poly
+// being the one the table was built or subdivided along
+bool corner_table_seam(const corner_table_t *ct, const poly_t *poly, int c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
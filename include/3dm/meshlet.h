@@ -0,0 +1,79 @@
+/**
+ * 3dm - simple 3D mathematic library
+ *
+ * Copyright (C) 2013 Cedric Fung <cedric@vec.io>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *    3. Neither the name of the Cedric Fung nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+
+ * THIS SOFTWARE IS PROVIDED BY Cedric Fung "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Cedric Fung BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef _3DM_MESHLET_H
+#define _3DM_MESHLET_H
+#include <stdbool.h>
+#include "3dm/3dm.h"
+#include "3dm/poly.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  int v_offset; // first of its vertices in meshlets_t.vertices
+  int t_offset; // first of its triangles in meshlets_t.triangles / 3
+  int v_count;
+  int t_count;
+  float center[3]; // bounding sphere
+  float radius;
+  float cone_apex[3]; // normal cone, all of it faces away from a viewer
+  float cone_axis[3]; // at p if dot(normalize(apex - p), axis) >= cutoff,
+  float cone_cutoff; // above 1 when the normals spread too far to tell
+} meshlet_t;
+
+// Clusters of neighbouring triangles of a poly_t, the triangles of a meshlet
+// index its vertices, which index the vertices of the poly_t.
+typedef struct {
+  meshlet_t *meshlets;
+  int *vertices; // poly vertex of each meshlet vertex
+  unsigned char *triangles; // 3 meshlet vertices per triangle
+  int m_len; // number of meshlets
+  int v_len; // length of vertices
+  int t_len; // length of triangles
+} meshlets_t;
+
+// max_vertices is at most 256, triangles are gathered across edges so the
+// meshlets stay compact, the normal cones assume outward facing triangles
+meshlets_t *meshlets_create(const poly_t *poly, int max_vertices, int max_triangles);
+
+void meshlets_destroy(meshlets_t *m);
+
+// Writes the index of each meshlet that intersects the view frustum of
+// view_projection and is not back facing to its center of projection,
+// returns their number.
+int meshlets_cull(const meshlets_t *m, mat4d view_projection, int *visible);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
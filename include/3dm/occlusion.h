@@ -0,0 +1,80 @@
+/**
+ * 3dm - simple 3D mathematic library
+ *
+ * Copyright (C) 2013 Cedric Fung <cedric@vec.io>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *    3. Neither the name of the Cedric Fung nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+
+ * THIS SOFTWARE IS PROVIDED BY Cedric Fung "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Cedric Fung BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef _3DM_OCCLUSION_H
+#define _3DM_OCCLUSION_H
+#include <stdbool.h>
+#include "3dm/3dm.h"
+#include "3dm/poly.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OCCLUSION_TILE 8
+
+// Low resolution depth buffer of occluders with the farthest depth of each
+// OCCLUSION_TILE square tile kept aside, so most queries stop at the tiles.
+// Depths are window depths, 0 at the near plane and 1 at the far plane, rows
+// go from the top of the screen like ray_unproject.
+typedef struct {
+  float *depth; // pitch floats per row, tiles_y * OCCLUSION_TILE rows
+  float *hiz; // tiles_x floats per row of tiles
+  int width;
+  int height;
+  int pitch;
+  int tiles_x;
+  int tiles_y;
+} occlusion_t;
+
+occlusion_t *occlusion_create(int width, int height);
+
+void occlusion_destroy(occlusion_t *o);
+
+void occlusion_clear(occlusion_t *o);
+
+// Rasterizes the triangles of poly, transformed by model_view_projection,
+// the rows of tiles are split in bands across threads when threads > 1.
+// The triangles are binned by band first, and the threads are started per
+// call, which only pays off for meshes of many thousand triangles.
+// Triangles crossing the near plane are skipped, which can only let more
+// objects through the queries.
+bool occlusion_rasterize(occlusion_t *o, const poly_t *poly, mat4d model_view_projection, int threads);
+
+// boxes are min x, y, z, max x, y, z per box in the space view_projection
+// applies to, visible[i] is false if box i is fully hidden by the occluders
+// or out of the view, returns the number of visible boxes
+int occlusion_test_boxes(const occlusion_t *o, mat4d view_projection, const float *boxes, int n, bool *visible);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -30,6 +30,8 @@
 
 #ifndef _3DM_POLY_H
 #define _3DM_POLY_H
+#include <stdbool.h>
+#include "3dm/3dm.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -38,6 +40,7 @@ extern "C" {
 enum poly_type {
   POLY_CUBE,
   POLY_ICOSAHEDRON,
+  POLY_CUBESPHERE,
 };
 
 typedef struct {
@@ -50,12 +53,80 @@ typedef struct {
   int i_len; // length of indices
   int v_cap;
   int t_cap;
+  int level; // subdivision level, -1 for adaptive meshes
 } poly_t;
 
+// Icosphere refined where the chord error seen through a view projection
+// is above a threshold in pixels. Midpoints are cached per edge as long as
+// the edge stays split, so a vertex keeps its index across the updates
+// using it. Midpoints of edges no longer split are evicted and their slots
+// reused, only the slots in v_dirty need uploading again, and the texture
+// seam copies appended after v_stable.
+typedef struct {
+  poly_t *poly;
+  int v_stable;
+  int max_level;
+  int *edges; // hash of edge to midpoint and last update splitting it, 4 ints per slot
+  int e_len;
+  int e_cap;
+  int i_cap;
+  int *v_free; // slots of evicted midpoints
+  int f_len;
+  int *v_dirty; // slots written by the last update
+  int d_len;
+  int s_cap; // capacity of v_free and v_dirty
+  int update;
+} poly_adaptive_t;
+
+// Levels 0 to n of a poly_t sharing the vertices and texcoords of level n,
+// the indices of level k are [i_offsets[k], i_offsets[k + 1]) of
+// poly->indices, so switching level only switches the index range.
+typedef struct {
+  poly_t *poly;
+  int levels;
+  int *i_offsets; // levels + 1 offsets into poly->indices
+} poly_lod_t;
+
 poly_t *poly_create(enum poly_type type, int n);
 
+// refines a poly_t from poly_create in place, as if it was created with
+// level + levels, only the new vertices get their texcoords computed,
+// on failure the poly can only be destroyed
+bool poly_subdivide(poly_t *poly, int levels);
+
 void poly_destroy(poly_t *poly);
 
+poly_lod_t *poly_lod_create(enum poly_type type, int n);
+
+// a poly_t of one level borrowing the buffers of lod, not to be destroyed
+poly_t poly_lod_get(const poly_lod_t *lod, int level);
+
+void poly_lod_destroy(poly_lod_t *lod);
+
+// finds the triangle (index in indices / 3) containing the direction of each
+// point, points are x, y, z like vertices, only uniform POLY_ICOSAHEDRON
+// meshes from poly_create or poly_subdivide are supported
+bool poly_locate(const poly_t *poly, const float *points, int n, int *triangles);
+
+// only POLY_ICOSAHEDRON is supported, the mesh is empty until updated
+poly_adaptive_t *poly_adaptive_create(enum poly_type type, int max_level);
+
+bool poly_adaptive_update(poly_adaptive_t *adaptive, mat4d view_projection, int height, double threshold);
+
+void poly_adaptive_destroy(poly_adaptive_t *adaptive);
+
+// Binary PLY with x, y, z, s, t per vertex, written through a small
+// staging buffer, so the mesh is never held twice in memory.
+bool poly_write_ply(const poly_t *poly, int fd);
+
+bool poly_export_ply(const poly_t *poly, const char *path);
+
+// glTF buffer: vertices, texcoords and indices written as they are with writev
+bool poly_write_gltf_bin(const poly_t *poly, int fd);
+
+// glTF JSON referring to bin_path relative to it, and the buffer at bin_path
+bool poly_export_gltf(const poly_t *poly, const char *path, const char *bin_path);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,72 @@
+/**
+ * 3dm - simple 3D mathematic library
+ *
+ * Copyright (C) 2013 Cedric Fung <cedric@vec.io>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *    3. Neither the name of the Cedric Fung nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+
+ * THIS SOFTWARE IS PROVIDED BY Cedric Fung "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Cedric Fung BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef _3DM_SKIN_H
+#define _3DM_SKIN_H
+#include <stdbool.h>
+#include "3dm/3dm.h"
+#include "3dm/poly.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SKIN_INFLUENCES 4
+
+// Up to SKIN_INFLUENCES bones per vertex of a poly_t, unused influences
+// have a weight of 0, the weights of a vertex should sum to 1.
+typedef struct {
+  unsigned short *bones; // SKIN_INFLUENCES per vertex
+  float *weights; // SKIN_INFLUENCES per vertex
+  int len; // number of vertices
+  int max_bone; // highest bone with a weight, -1 if none
+} poly_skin_t;
+
+// every vertex starts with no influence
+poly_skin_t *poly_skin_create(const poly_t *poly);
+
+void poly_skin_destroy(poly_skin_t *skin);
+
+bool poly_skin_set(poly_skin_t *skin, int vertex, const int bones[SKIN_INFLUENCES], const float weights[SKIN_INFLUENCES]);
+
+// Blends the palette matrices of each vertex and transforms its position,
+// and its normal when normals is not NULL (renormalized, which is exact for
+// palettes without non-uniform scale). vertices and normals are x, y, z like
+// poly_t.vertices, out_normals may be NULL if normals is. The vertices are
+// split across threads when threads > 1. Fails if a bone is not in palette.
+bool poly_skin_apply(const poly_skin_t *skin, const aff34f *palette, int p_len,
+                     const float *vertices, const float *normals,
+                     float *out_vertices, float *out_normals, int threads);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
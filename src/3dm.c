@@ -153,6 +153,35 @@ vec4d mat4d_multiply_vec4d(mat4d m, vec4d v)
   return vr;
 }
 
+mat4d mat4d_inverse(mat4d m)
+{
+  const double *a = m.ptr;
+  mat4d r = vector_new(0);
+  double *c = r.ptr;
+  c[0] = a[5]*a[10]*a[15] - a[5]*a[11]*a[14] - a[9]*a[6]*a[15] + a[9]*a[7]*a[14] + a[13]*a[6]*a[11] - a[13]*a[7]*a[10];
+  c[4] = -a[4]*a[10]*a[15] + a[4]*a[11]*a[14] + a[8]*a[6]*a[15] - a[8]*a[7]*a[14] - a[12]*a[6]*a[11] + a[12]*a[7]*a[10];
+  c[8] = a[4]*a[9]*a[15] - a[4]*a[11]*a[13] - a[8]*a[5]*a[15] + a[8]*a[7]*a[13] + a[12]*a[5]*a[11] - a[12]*a[7]*a[9];
+  c[12] = -a[4]*a[9]*a[14] + a[4]*a[10]*a[13] + a[8]*a[5]*a[14] - a[8]*a[6]*a[13] - a[12]*a[5]*a[10] + a[12]*a[6]*a[9];
+  c[1] = -a[1]*a[10]*a[15] + a[1]*a[11]*a[14] + a[9]*a[2]*a[15] - a[9]*a[3]*a[14] - a[13]*a[2]*a[11] + a[13]*a[3]*a[10];
+  c[5] = a[0]*a[10]*a[15] - a[0]*a[11]*a[14] - a[8]*a[2]*a[15] + a[8]*a[3]*a[14] + a[12]*a[2]*a[11] - a[12]*a[3]*a[10];
+  c[9] = -a[0]*a[9]*a[15] + a[0]*a[11]*a[13] + a[8]*a[1]*a[15] - a[8]*a[3]*a[13] - a[12]*a[1]*a[11] + a[12]*a[3]*a[9];
+  c[13] = a[0]*a[9]*a[14] - a[0]*a[10]*a[13] - a[8]*a[1]*a[14] + a[8]*a[2]*a[13] + a[12]*a[1]*a[10] - a[12]*a[2]*a[9];
+  c[2] = a[1]*a[6]*a[15] - a[1]*a[7]*a[14] - a[5]*a[2]*a[15] + a[5]*a[3]*a[14] + a[13]*a[2]*a[7] - a[13]*a[3]*a[6];
+  c[6] = -a[0]*a[6]*a[15] + a[0]*a[7]*a[14] + a[4]*a[2]*a[15] - a[4]*a[3]*a[14] - a[12]*a[2]*a[7] + a[12]*a[3]*a[6];
+  c[10] = a[0]*a[5]*a[15] - a[0]*a[7]*a[13] - a[4]*a[1]*a[15] + a[4]*a[3]*a[13] + a[12]*a[1]*a[7] - a[12]*a[3]*a[5];
+  c[14] = -a[0]*a[5]*a[14] + a[0]*a[6]*a[13] + a[4]*a[1]*a[14] - a[4]*a[2]*a[13] - a[12]*a[1]*a[6] + a[12]*a[2]*a[5];
+  c[3] = -a[1]*a[6]*a[11] + a[1]*a[7]*a[10] + a[5]*a[2]*a[11] - a[5]*a[3]*a[10] - a[9]*a[2]*a[7] + a[9]*a[3]*a[6];
+  c[7] = a[0]*a[6]*a[11] - a[0]*a[7]*a[10] - a[4]*a[2]*a[11] + a[4]*a[3]*a[10] + a[8]*a[2]*a[7] - a[8]*a[3]*a[6];
+  c[11] = -a[0]*a[5]*a[11] + a[0]*a[7]*a[9] + a[4]*a[1]*a[11] - a[4]*a[3]*a[9] - a[8]*a[1]*a[7] + a[8]*a[3]*a[5];
+  c[15] = a[0]*a[5]*a[10] - a[0]*a[6]*a[9] - a[4]*a[1]*a[10] + a[4]*a[2]*a[9] + a[8]*a[1]*a[6] - a[8]*a[2]*a[5];
+
+  double det = a[0]*c[0] + a[1]*c[4] + a[2]*c[8] + a[3]*c[12];
+  if (det == 0) {
+    return (mat4d)vector_new(0);
+  }
+  return vector_scale(r, 1.0 / det);
+}
+
 mat4d mat4d_scale(mat4d m, double x, double y, double z)
 {
   mat4d s = mat4d_identity();
@@ -174,7 +203,8 @@ mat4d mat4d_translate(mat4d m, double x, double y, double z)
 mat4d mat4d_rotate(mat4d m, vec4d axis, double degree)
 {
   double rad = degree * M_PI / 180;
-  double s = sin(rad), c = cos(rad);
+  double s, c;
+  approx_sincos(rad, &s, &c, precision_get());
   vec4d u = vec4d_normalize(axis);
   mat4d m1 = vector_scale(mat4d_identity(), c);
   mat4d m2 = vector_scale(vec4d_cross_matrix(axis), s);
@@ -199,7 +229,7 @@ mat4d mat4d_frustum(double l, double r, double b, double t, double n, double f)
 
 mat4d mat4d_perspective(double fov, double aspect, double n, double f)
 {
-  double t = n * tan(fov * M_PI / 360);
+  double t = n * approx_tan(fov * M_PI / 360, precision_get());
   double r = t * aspect;
   return mat4d_frustum(-r, r, -t, t, n, f);
 }
@@ -219,7 +249,7 @@ mat4d mat4d_frustum_ortho(double l, double r, double b, double t, double n, doub
 
 mat4d mat4d_ortho(double fov, double aspect, double n, double f)
 {
-  double t = n * tan(fov * M_PI / 360);
+  double t = n * approx_tan(fov * M_PI / 360, precision_get());
   double r = t * aspect;
   return mat4d_frustum_ortho(-r, r, -t, t, n, f);
 }
@@ -244,6 +274,16 @@ mat4d mat4d_look_at(vec4d eye, vec4d center, vec4d up)
   return mat4d_from_vec4d(x, y, z, w);
 }
 
+vec4d mat4d_projection_center(mat4d m)
+{
+  // the center of projection is mapped to clip (0, 0, z, 0)
+  vec4d c = mat4d_multiply_vec4d(mat4d_inverse(m), (vec4d)vector_new(0, 0, 1, 0));
+  if (c.ptr[3] == 0) {
+    return vec4d_normalize(c);
+  }
+  return vector_scale(c, 1.0 / c.ptr[3]);
+}
+
 mat4f mat4d_to_mat4f(mat4d m)
 {
   mat4f f = vector_new(0);
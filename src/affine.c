@@ -0,0 +1,192 @@
+/**
+ * 3dm - simple 3D mathematic library
+ *
+ * Copyright (C) 2013 Cedric Fung <cedric@vec.io>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *    3. Neither the name of the Cedric Fung nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+
+ * THIS SOFTWARE IS PROVIDED BY Cedric Fung "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Cedric Fung BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#define _GNU_SOURCE
+#include <math.h>
+#include "3dm/3dm.h"
+
+aff34d aff34d_identity(void)
+{
+  aff34d a = {{0}};
+  a.ptr[0] = 1;
+  a.ptr[5] = 1;
+  a.ptr[10] = 1;
+  return a;
+}
+
+aff34d aff34d_from_mat4d(mat4d m)
+{
+  aff34d a;
+  for (int i = 0; i < 12; i++) {
+    a.ptr[i] = m.ptr[i];
+  }
+  return a;
+}
+
+mat4d aff34d_to_mat4d(aff34d a)
+{
+  mat4d m = vector_new(0);
+  for (int i = 0; i < 12; i++) {
+    m.ptr[i] = a.ptr[i];
+  }
+  m.ptr[15] = 1;
+  return m;
+}
+
+aff34f aff34d_to_aff34f(aff34d a)
+{
+  aff34f f;
+  for (int i = 0; i < 12; i++) {
+    f.ptr[i] = (float)a.ptr[i];
+  }
+  return f;
+}
+
+aff34d aff34d_multiply(aff34d a, aff34d b)
+{
+  aff34d r;
+  for (int i = 0; i < 3; i++) {
+    const double *ai = a.row[i].ptr;
+    r.row[i].vex = ai[0] * b.row[0].vex + ai[1] * b.row[1].vex + ai[2] * b.row[2].vex;
+    r.row[i].ptr[3] += ai[3];
+  }
+  return r;
+}
+
+vec4d aff34d_transform_point(aff34d a, vec4d p)
+{
+  vec4d r = vector_new(0, 0, 0, 1);
+  p.ptr[3] = 1;
+  for (int i = 0; i < 3; i++) {
+    r.ptr[i] = vec4d_dot_product(a.row[i], p);
+  }
+  return r;
+}
+
+vec4d aff34d_transform_direction(aff34d a, vec4d d)
+{
+  vec4d r = vector_new(0);
+  d.ptr[3] = 0;
+  for (int i = 0; i < 3; i++) {
+    r.ptr[i] = vec4d_dot_product(a.row[i], d);
+  }
+  return r;
+}
+
+aff34d aff34d_inverse(aff34d a)
+{
+  // inverse of the linear part by cofactors, then t' = -inverse * t
+  const double *m = a.ptr;
+  aff34d r = {{0}};
+  double c0 = m[5] * m[10] - m[6] * m[9];
+  double c1 = m[6] * m[8] - m[4] * m[10];
+  double c2 = m[4] * m[9] - m[5] * m[8];
+  double det = m[0] * c0 + m[1] * c1 + m[2] * c2;
+  if (det == 0) {
+    return r;
+  }
+  double id = 1.0 / det;
+  r.ptr[0] = c0 * id;
+  r.ptr[1] = (m[2] * m[9] - m[1] * m[10]) * id;
+  r.ptr[2] = (m[1] * m[6] - m[2] * m[5]) * id;
+  r.ptr[4] = c1 * id;
+  r.ptr[5] = (m[0] * m[10] - m[2] * m[8]) * id;
+  r.ptr[6] = (m[2] * m[4] - m[0] * m[6]) * id;
+  r.ptr[8] = c2 * id;
+  r.ptr[9] = (m[1] * m[8] - m[0] * m[9]) * id;
+  r.ptr[10] = (m[0] * m[5] - m[1] * m[4]) * id;
+  for (int i = 0; i < 3; i++) {
+    double *ri = r.row[i].ptr;
+    ri[3] = -(ri[0] * m[3] + ri[1] * m[7] + ri[2] * m[11]);
+  }
+  return r;
+}
+
+aff34d aff34d_scale(aff34d a, double x, double y, double z)
+{
+  a.row[0] = vector_scale(a.row[0], x);
+  a.row[1] = vector_scale(a.row[1], y);
+  a.row[2] = vector_scale(a.row[2], z);
+  return a;
+}
+
+aff34d aff34d_translate(aff34d a, double x, double y, double z)
+{
+  a.ptr[3] += x;
+  a.ptr[7] += y;
+  a.ptr[11] += z;
+  return a;
+}
+
+aff34d aff34d_rotate(aff34d a, vec4d axis, double degree)
+{
+  return aff34d_multiply(aff34d_from_mat4d(mat4d_rotate(mat4d_identity(), axis, degree)), a);
+}
+
+mat4f aff34f_to_mat4f(aff34f a)
+{
+  mat4f m = vector_new(0);
+  for (int i = 0; i < 12; i++) {
+    m.ptr[i] = a.ptr[i];
+  }
+  m.ptr[15] = 1;
+  return m;
+}
+
+aff34f aff34f_multiply(aff34f a, aff34f b)
+{
+  aff34f r;
+  for (int i = 0; i < 3; i++) {
+    const float *ai = a.row[i].ptr;
+    r.row[i].vex = ai[0] * b.row[0].vex + ai[1] * b.row[1].vex + ai[2] * b.row[2].vex;
+    r.row[i].ptr[3] += ai[3];
+  }
+  return r;
+}
+
+vec4f aff34f_transform_point(aff34f a, vec4f p)
+{
+  vec4f r = vector_new(0, 0, 0, 1);
+  for (int i = 0; i < 3; i++) {
+    const float *ai = a.row[i].ptr;
+    r.ptr[i] = ai[0] * p.ptr[0] + ai[1] * p.ptr[1] + ai[2] * p.ptr[2] + ai[3];
+  }
+  return r;
+}
+
+vec4f aff34f_transform_direction(aff34f a, vec4f d)
+{
+  vec4f r = vector_new(0);
+  for (int i = 0; i < 3; i++) {
+    const float *ai = a.row[i].ptr;
+    r.ptr[i] = ai[0] * d.ptr[0] + ai[1] * d.ptr[1] + ai[2] * d.ptr[2];
+  }
+  return r;
+}
@@ -0,0 +1,103 @@
+/**
+ * 3dm - simple 3D mathematic library
+ *
+ * Copyright (C) 2013 Cedric Fung <cedric@vec.io>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *    3. Neither the name of the Cedric Fung nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+
+ * THIS SOFTWARE IS PROVIDED BY Cedric Fung "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Cedric Fung BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#define _GNU_SOURCE
+#include <math.h>
+#include "3dm/3dm.h"
+
+static __thread enum precision precision = PRECISION_EXACT;
+
+void precision_set(enum precision p)
+{
+  precision = p;
+}
+
+enum precision precision_get(void)
+{
+  return precision;
+}
+
+void approx_sincos(double x, double *s, double *c, enum precision p)
+{
+  if (p == PRECISION_EXACT || !(fabs(x) < APPROX_SINCOS_MAX)) {
+    *s = sin(x);
+    *c = cos(x);
+    return;
+  }
+
+  // Reduce to [-pi/4, pi/4] with pi/2 split in three 33 bit parts and a
+  // tail (fdlibm's), k * part is exact for k < 2^20, then pick the quadrant.
+  const double pio2_1 = 1.57079632673412561417e+00, pio2_2 = 6.07710050630396597660e-11;
+  const double pio2_3 = 2.02226624871116645580e-21, pio2_3t = 8.47842766036889956997e-32;
+  double k = nearbyint(x * M_2_PI);
+  double r = ((x - k * pio2_1) - k * pio2_2) - k * pio2_3;
+  r -= k * pio2_3t;
+  double r2 = r * r, sr, cr;
+  if (p == PRECISION_FAST) {
+    sr = r + r * r2 * (-1.0 / 6 + r2 * (1.0 / 120 + r2 * (-1.0 / 5040 + r2 * (1.0 / 362880 +
+        r2 * (-1.0 / 39916800 + r2 * (1.0 / 6227020800))))));
+    cr = 1 + r2 * (-0.5 + r2 * (1.0 / 24 + r2 * (-1.0 / 720 + r2 * (1.0 / 40320 +
+        r2 * (-1.0 / 3628800 + r2 * (1.0 / 479001600 + r2 * (-1.0 / 87178291200)))))));
+  } else {
+    sr = r + r * r2 * (-1.0 / 6 + r2 * (1.0 / 120 + r2 * (-1.0 / 5040 + r2 * (1.0 / 362880))));
+    cr = 1 + r2 * (-0.5 + r2 * (1.0 / 24 + r2 * (-1.0 / 720 + r2 * (1.0 / 40320 + r2 * (-1.0 / 3628800)))));
+  }
+
+  switch ((long)k & 3) {
+    case 0: *s = sr; *c = cr; break;
+    case 1: *s = cr; *c = -sr; break;
+    case 2: *s = -sr; *c = -cr; break;
+    default: *s = -cr; *c = sr;
+  }
+}
+
+double approx_sin(double x, enum precision p)
+{
+  double s, c;
+  approx_sincos(x, &s, &c, p);
+  return s;
+}
+
+double approx_cos(double x, enum precision p)
+{
+  double s, c;
+  approx_sincos(x, &s, &c, p);
+  return c;
+}
+
+double approx_tan(double x, enum precision p)
+{
+  double s, c;
+  if (p == PRECISION_EXACT) {
+    return tan(x);
+  }
+  approx_sincos(x, &s, &c, p);
+  return s / c;
+}
@@ -0,0 +1,170 @@
+/**
+ * 3dm - simple 3D mathematic library
+ *
+ * Copyright (C) 2013 Cedric Fung <cedric@vec.io>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *    3. Neither the name of the Cedric Fung nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+
+ * THIS SOFTWARE IS PROVIDED BY Cedric Fung "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Cedric Fung BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+#include "3dm/3dm.h"
+#include "3dm/array.h"
+#include "parallel.h"
+
+#define ARRAY_DEFINE(type, scalar, lanes) \
+typedef vector(scalar, lanes) type##_lanes; \
+\
+typedef struct { \
+  type##_array *r; \
+  const type##_array *a, *b; \
+  type m; \
+} type##_array_job_t; \
+\
+type##_array *type##_array_create(int len) \
+{ \
+  type##_array *a = malloc(sizeof(type##_array)); \
+  if (a == NULL) { \
+    return NULL; \
+  } \
+  size_t size = ((len + lanes - 1) / lanes) * 16 * lanes * sizeof(scalar); \
+  if (posix_memalign((void **)&a->ptr, 64, size) != 0) { \
+    free(a); \
+    return NULL; \
+  } \
+  memset(a->ptr, 0, size); \
+  a->len = len; \
+  return a; \
+} \
+\
+void type##_array_destroy(type##_array *a) \
+{ \
+  free(a->ptr); \
+  free(a); \
+} \
+\
+void type##_array_set(type##_array *a, int i, type m) \
+{ \
+  scalar *p = a->ptr + (i / lanes) * 16 * lanes + i % lanes; \
+  for (int e = 0; e < 16; e++) { \
+    p[e * lanes] = m.ptr[e]; \
+  } \
+} \
+\
+type type##_array_get(const type##_array *a, int i) \
+{ \
+  type m; \
+  const scalar *p = a->ptr + (i / lanes) * 16 * lanes + i % lanes; \
+  for (int e = 0; e < 16; e++) { \
+    m.ptr[e] = p[e * lanes]; \
+  } \
+  return m; \
+} \
+\
+static void type##_array_multiply_left(void *ctx, int begin, int end) \
+{ \
+  type##_array_job_t *job = ctx; \
+  const scalar *m = job->m.ptr; \
+  for (int blk = begin; blk < end; blk++) { \
+    const type##_lanes *a = (const type##_lanes *)job->a->ptr + blk * 16; \
+    type##_lanes *r = (type##_lanes *)job->r->ptr + blk * 16; \
+    type##_lanes c[16]; \
+    for (int i = 0; i < 4; i++) { \
+      for (int j = 0; j < 4; j++) { \
+        c[i*4+j] = m[i*4] * a[j] + m[i*4+1] * a[4+j] + m[i*4+2] * a[8+j] + m[i*4+3] * a[12+j]; \
+      } \
+    } \
+    memcpy(r, c, sizeof(c)); \
+  } \
+} \
+\
+static void type##_array_multiply_pairs(void *ctx, int begin, int end) \
+{ \
+  type##_array_job_t *job = ctx; \
+  for (int blk = begin; blk < end; blk++) { \
+    const type##_lanes *a = (const type##_lanes *)job->a->ptr + blk * 16; \
+    const type##_lanes *b = (const type##_lanes *)job->b->ptr + blk * 16; \
+    type##_lanes *r = (type##_lanes *)job->r->ptr + blk * 16; \
+    type##_lanes c[16]; \
+    for (int i = 0; i < 4; i++) { \
+      for (int j = 0; j < 4; j++) { \
+        c[i*4+j] = a[i*4] * b[j] + a[i*4+1] * b[4+j] + a[i*4+2] * b[8+j] + a[i*4+3] * b[12+j]; \
+      } \
+    } \
+    memcpy(r, c, sizeof(c)); \
+  } \
+} \
+\
+bool type##_array_multiply_##type(type##_array *r, type m, const type##_array *a, int threads) \
+{ \
+  if (r->len < a->len) { \
+    return false; \
+  } \
+  type##_array_job_t job = { .r = r, .a = a, .m = m }; \
+  parallel_for(type##_array_multiply_left, &job, (a->len + lanes - 1) / lanes, threads); \
+  return true; \
+} \
+\
+bool type##_array_multiply(type##_array *r, const type##_array *a, const type##_array *b, int threads) \
+{ \
+  if (r->len < a->len || b->len < a->len) { \
+    return false; \
+  } \
+  type##_array_job_t job = { .r = r, .a = a, .b = b }; \
+  parallel_for(type##_array_multiply_pairs, &job, (a->len + lanes - 1) / lanes, threads); \
+  return true; \
+}
+
+ARRAY_DEFINE(mat4d, double, MAT4D_LANES)
+ARRAY_DEFINE(mat4f, float, MAT4F_LANES)
+
+void mat4d_to_mat4f_columns(float *dst, const mat4d *src, int len, bool stream)
+{
+  vector(int, 16) mask = {0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15};
+  vector(float, 16) f;
+
+#ifdef __SSE__
+  if (stream && ((uintptr_t)dst & 15) == 0) {
+    for (int i = 0; i < len; i++, dst += 16) {
+      f = vector_shuffle(__builtin_convertvector(src[i].vex, vector(float, 16)), mask);
+      for (int j = 0; j < 4; j++) {
+        _mm_stream_ps(dst + 4 * j, (__m128){f[4*j], f[4*j+1], f[4*j+2], f[4*j+3]});
+      }
+    }
+    _mm_sfence();
+    return;
+  }
+#endif
+
+  for (int i = 0; i < len; i++, dst += 16) {
+    f = vector_shuffle(__builtin_convertvector(src[i].vex, vector(float, 16)), mask);
+    memcpy(dst, &f, sizeof(f));
+  }
+}
@@ -0,0 +1,363 @@
+/**
+ * 3dm - simple 3D mathematic library
+ *
+ * Copyright (C) 2013 Cedric Fung <cedric@vec.io>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *    3. Neither the name of the Cedric Fung nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+
+ * THIS SOFTWARE IS PROVIDED BY Cedric Fung "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Cedric Fung BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+#include "3dm/3dm.h"
+#include "3dm/poly.h"
+#include "3dm/bvh.h"
+
+#define BVH_BINS 16
+#define BVH_LEAF 4
+#define BVH_DEPTH 60
+
+typedef vector(float, 4) v4f;
+typedef vector(int, 4) v4i;
+
+typedef struct {
+  float min[3], max[3];
+} bvh_box_t;
+
+typedef struct {
+  bvh_t *bvh;
+  const float *bounds; // min, max per triangle
+  const float *centroids;
+} bvh_builder_t;
+
+static void box_empty(bvh_box_t *b)
+{
+  for (int k = 0; k < 3; k++) {
+    b->min[k] = FLT_MAX;
+    b->max[k] = -FLT_MAX;
+  }
+}
+
+static void box_grow(bvh_box_t *b, const float *min, const float *max)
+{
+  for (int k = 0; k < 3; k++) {
+    b->min[k] = fminf(b->min[k], min[k]);
+    b->max[k] = fmaxf(b->max[k], max[k]);
+  }
+}
+
+static float box_area(const bvh_box_t *b)
+{
+  float x = b->max[0] - b->min[0], y = b->max[1] - b->min[1], z = b->max[2] - b->min[2];
+  return x < 0 ? 0 : x * y + y * z + z * x;
+}
+
+static int bvh_build(bvh_builder_t *b, int start, int count, int depth)
+{
+  bvh_t *bvh = b->bvh;
+  int *ids = bvh->ids;
+  int ni = bvh->n_len++;
+  bvh_node_t *node = bvh->nodes + ni;
+  bvh_box_t box, cbox;
+  box_empty(&box);
+  box_empty(&cbox);
+  for (int i = start; i < start + count; i++) {
+    const float *c = b->centroids + ids[i] * 3;
+    box_grow(&box, b->bounds + ids[i] * 6, b->bounds + ids[i] * 6 + 3);
+    box_grow(&cbox, c, c);
+  }
+  memcpy(node->min, box.min, sizeof(node->min));
+  memcpy(node->max, box.max, sizeof(node->max));
+  node->start = start;
+  node->count = count;
+
+  int axis = 0;
+  for (int k = 1; k < 3; k++) {
+    if (cbox.max[k] - cbox.min[k] > cbox.max[axis] - cbox.min[axis]) { axis = k; }
+  }
+  float cmin = cbox.min[axis], extent = cbox.max[axis] - cmin;
+  if (count <= BVH_LEAF || depth >= BVH_DEPTH || extent <= 0) {
+    return ni;
+  }
+
+  // binned SAH along the longest centroid axis
+  bvh_box_t bins[BVH_BINS], right[BVH_BINS];
+  int counts[BVH_BINS] = {0};
+  float scale = BVH_BINS / extent;
+  for (int i = 0; i < BVH_BINS; i++) { box_empty(&bins[i]); }
+  for (int i = start; i < start + count; i++) {
+    int bi = (b->centroids[ids[i] * 3 + axis] - cmin) * scale;
+    bi = bi < BVH_BINS ? bi : BVH_BINS - 1;
+    counts[bi]++;
+    box_grow(&bins[bi], b->bounds + ids[i] * 6, b->bounds + ids[i] * 6 + 3);
+  }
+  bvh_box_t acc;
+  box_empty(&acc);
+  for (int i = BVH_BINS - 1; i > 0; i--) {
+    box_grow(&acc, bins[i].min, bins[i].max);
+    right[i] = acc;
+  }
+  box_empty(&acc);
+  int nl = 0, split = -1;
+  float best = count * box_area(&box);
+  for (int i = 0; i < BVH_BINS - 1; i++) {
+    box_grow(&acc, bins[i].min, bins[i].max);
+    nl += counts[i];
+    if (nl == 0 || nl == count) { continue; }
+    float cost = nl * box_area(&acc) + (count - nl) * box_area(&right[i+1]);
+    if (cost < best) {
+      best = cost;
+      split = i;
+    }
+  }
+
+  int mid = start + count / 2;
+  if (split >= 0) {
+    int l = start, r = start + count - 1;
+    while (l <= r) {
+      int bi = (b->centroids[ids[l] * 3 + axis] - cmin) * scale;
+      if ((bi < BVH_BINS ? bi : BVH_BINS - 1) <= split) {
+        l++;
+      } else {
+        int t = ids[l]; ids[l] = ids[r]; ids[r--] = t;
+      }
+    }
+    mid = l;
+  } else if (count <= BVH_LEAF * 4) {
+    return ni;
+  }
+
+  bvh_build(b, start, mid - start, depth + 1);
+  int right_child = bvh_build(b, mid, start + count - mid, depth + 1);
+  node = bvh->nodes + ni;
+  node->start = right_child;
+  node->count = 0;
+  return ni;
+}
+
+bvh_t *bvh_create(const poly_t *poly)
+{
+  bvh_t *bvh = calloc(1, sizeof(bvh_t));
+  if (bvh == NULL) {
+    return NULL;
+  }
+  bvh->t_len = poly->i_len / 3;
+  bvh->nodes = malloc((bvh->t_len * 2 + 1) * sizeof(bvh_node_t));
+  bvh->triangles = malloc((bvh->t_len * 9 + 1) * sizeof(float));
+  bvh->ids = malloc((bvh->t_len + 1) * sizeof(int));
+  float *bounds = malloc((bvh->t_len * 6 + 1) * sizeof(float));
+  float *centroids = malloc((bvh->t_len * 3 + 1) * sizeof(float));
+  if (bvh->nodes == NULL || bvh->triangles == NULL || bvh->ids == NULL ||
+      bounds == NULL || centroids == NULL) {
+    free(bounds);
+    free(centroids);
+    bvh_destroy(bvh);
+    return NULL;
+  }
+
+  for (int t = 0; t < bvh->t_len; t++) {
+    const float *v[3];
+    for (int j = 0; j < 3; j++) {
+      v[j] = poly->vertices + poly->indices[t * 3 + j] * 3;
+    }
+    for (int k = 0; k < 3; k++) {
+      bounds[t * 6 + k] = fminf(v[0][k], fminf(v[1][k], v[2][k]));
+      bounds[t * 6 + k + 3] = fmaxf(v[0][k], fmaxf(v[1][k], v[2][k]));
+      centroids[t * 3 + k] = (v[0][k] + v[1][k] + v[2][k]) / 3;
+    }
+    bvh->ids[t] = t;
+  }
+
+  // an empty poly gets no root, a root without triangles would read as an
+  // inner node
+  bvh_builder_t builder = { bvh, bounds, centroids };
+  if (bvh->t_len > 0) {
+    bvh_build(&builder, 0, bvh->t_len, 0);
+  }
+  free(bounds);
+  free(centroids);
+
+  for (int i = 0; i < bvh->t_len; i++) {
+    const int *is = poly->indices + bvh->ids[i] * 3;
+    const float *v0 = poly->vertices + is[0] * 3;
+    const float *v1 = poly->vertices + is[1] * 3;
+    const float *v2 = poly->vertices + is[2] * 3;
+    float *tri = bvh->triangles + i * 9;
+    for (int k = 0; k < 3; k++) {
+      tri[k] = v0[k];
+      tri[k+3] = v1[k] - v0[k];
+      tri[k+6] = v2[k] - v0[k];
+    }
+  }
+
+  return bvh;
+}
+
+void bvh_destroy(bvh_t *bvh)
+{
+  free(bvh->nodes);
+  free(bvh->triangles);
+  free(bvh->ids);
+  free(bvh);
+}
+
+static inline v4f v4f_select(v4i mask, v4f a, v4f b)
+{
+  return (v4f)((mask & (v4i)a) | (~mask & (v4i)b));
+}
+
+static inline v4f v4f_min(v4f a, v4f b)
+{
+  return v4f_select(a < b, a, b);
+}
+
+static inline v4f v4f_max(v4f a, v4f b)
+{
+  return v4f_select(a > b, a, b);
+}
+
+static inline bool v4i_any(v4i mask)
+{
+  return (mask[0] | mask[1] | mask[2] | mask[3]) != 0;
+}
+
+// traces up to 4 rays, lanes with a negative t of their hit are inactive
+static void bvh_intersect_packet(const bvh_t *bvh, const ray_t *rays, ray_hit_t *hits, int n)
+{
+  v4f o[3], d[3], inv[3], best = {-1, -1, -1, -1};
+  v4f bu = {0}, bv = {0};
+  v4i bid = {-1, -1, -1, -1};
+  for (int k = 0; k < 3; k++) {
+    for (int l = 0; l < 4; l++) {
+      const ray_t *r = rays + (l < n ? l : 0);
+      o[k][l] = r->origin.ptr[k];
+      d[k][l] = r->direction.ptr[k];
+    }
+    inv[k] = 1.0f / d[k];
+  }
+  for (int l = 0; l < 4; l++) {
+    best[l] = l < n ? FLT_MAX : -1;
+  }
+
+  int stack[BVH_DEPTH * 2 + 4], sp = 0;
+  if (bvh->n_len > 0) {
+    stack[sp++] = 0;
+  }
+  while (sp > 0) {
+    const bvh_node_t *node = bvh->nodes + stack[--sp];
+    v4f tmin = {0}, tmax = best;
+    for (int k = 0; k < 3; k++) {
+      v4f t1 = (node->min[k] - o[k]) * inv[k];
+      v4f t2 = (node->max[k] - o[k]) * inv[k];
+      tmin = v4f_max(tmin, v4f_min(t1, t2));
+      tmax = v4f_min(tmax, v4f_max(t1, t2));
+    }
+    if (!v4i_any(tmin <= tmax)) {
+      continue;
+    }
+    if (node->count == 0) {
+      // visit the child nearer along the first ray first
+      const bvh_node_t *l = node + 1, *r = bvh->nodes + node->start;
+      float along = 0;
+      for (int k = 0; k < 3; k++) {
+        along += d[k][0] * (r->min[k] + r->max[k] - l->min[k] - l->max[k]);
+      }
+      stack[sp++] = along > 0 ? node->start : node - bvh->nodes + 1;
+      stack[sp++] = along > 0 ? node - bvh->nodes + 1 : node->start;
+      continue;
+    }
+
+    for (int i = node->start; i < node->start + node->count; i++) {
+      const float *tri = bvh->triangles + i * 9;
+      v4f p[3], q[3], s[3];
+      // Moller-Trumbore, p = d x e2, s = o - v0, q = s x e1
+      p[0] = d[1] * tri[8] - d[2] * tri[7];
+      p[1] = d[2] * tri[6] - d[0] * tri[8];
+      p[2] = d[0] * tri[7] - d[1] * tri[6];
+      v4f det = tri[3] * p[0] + tri[4] * p[1] + tri[5] * p[2];
+      v4f idet = 1.0f / det;
+      for (int k = 0; k < 3; k++) { s[k] = o[k] - tri[k]; }
+      v4f u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * idet;
+      q[0] = s[1] * tri[5] - s[2] * tri[4];
+      q[1] = s[2] * tri[3] - s[0] * tri[5];
+      q[2] = s[0] * tri[4] - s[1] * tri[3];
+      v4f v = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) * idet;
+      v4f t = (tri[6] * q[0] + tri[7] * q[1] + tri[8] * q[2]) * idet;
+      v4i hit = (det != 0) & (u >= 0) & (v >= 0) & (u + v <= 1) & (t > 0) & (t < best);
+      if (v4i_any(hit)) {
+        best = v4f_select(hit, t, best);
+        bu = v4f_select(hit, u, bu);
+        bv = v4f_select(hit, v, bv);
+        bid = (hit & bvh->ids[i]) | (~hit & bid);
+      }
+    }
+  }
+
+  for (int l = 0; l < n; l++) {
+    hits[l].triangle = bid[l];
+    hits[l].t = bid[l] < 0 ? INFINITY : best[l];
+    hits[l].u = bu[l];
+    hits[l].v = bv[l];
+  }
+}
+
+bool bvh_intersect(const bvh_t *bvh, ray_t ray, ray_hit_t *hit)
+{
+  bvh_intersect_packet(bvh, &ray, hit, 1);
+  return hit->triangle >= 0;
+}
+
+int bvh_intersect_rays(const bvh_t *bvh, const ray_t *rays, ray_hit_t *hits, int n)
+{
+  int count = 0;
+  for (int i = 0; i < n; i += 4) {
+    bvh_intersect_packet(bvh, rays + i, hits + i, n - i < 4 ? n - i : 4);
+  }
+  for (int i = 0; i < n; i++) {
+    count += hits[i].triangle >= 0;
+  }
+  return count;
+}
+
+ray_t ray_unproject(mat4d inverse, double x, double y, double width, double height)
+{
+  double nx = 2 * x / width - 1, ny = 1 - 2 * y / height;
+  vec4d near = mat4d_multiply_vec4d(inverse, (vec4d)vector_new(nx, ny, -1, 1));
+  vec4d far = mat4d_multiply_vec4d(inverse, (vec4d)vector_new(nx, ny, 1, 1));
+  near = vector_scale(near, 1.0 / near.ptr[3]);
+  far = vector_scale(far, 1.0 / far.ptr[3]);
+  vec4d dir = vector_add(far, vector_scale(near, -1));
+  dir.ptr[3] = 0;
+  dir = vec4d_normalize(dir);
+
+  ray_t ray;
+  for (int k = 0; k < 4; k++) {
+    ray.origin.ptr[k] = near.ptr[k];
+    ray.direction.ptr[k] = dir.ptr[k];
+  }
+  return ray;
+}
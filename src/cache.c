@@ -0,0 +1,196 @@
+/**
+ * 3dm - simple 3D mathematic library
+ *
+ * Copyright (C) 2013 Cedric Fung <cedric@vec.io>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *    3. Neither the name of the Cedric Fung nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+
+ * THIS SOFTWARE IS PROVIDED BY Cedric Fung "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Cedric Fung BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include "3dm/cache.h"
+
+typedef struct cache_entry {
+  struct cache_entry *next;
+  enum poly_type type;
+  int level;
+  poly_t *poly; // NULL while building or if the build failed
+  bool building;
+  int refs;
+  long used; // tick of the last acquire
+  size_t bytes;
+} cache_entry_t;
+
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cache_built = PTHREAD_COND_INITIALIZER;
+static cache_entry_t *cache_entries = NULL;
+static size_t cache_budget = 0;
+static long cache_tick = 0;
+static poly_cache_stats_t cache_stats = {0};
+
+static void cache_unlink(cache_entry_t *entry)
+{
+  for (cache_entry_t **e = &cache_entries; *e != NULL; e = &(*e)->next) {
+    if (*e == entry) {
+      *e = entry->next;
+      return;
+    }
+  }
+}
+
+// called with cache_lock held, frees unreferenced entries, oldest first,
+// until the cache fits in budget
+static void cache_evict(size_t budget)
+{
+  while (cache_stats.bytes > budget) {
+    cache_entry_t *oldest = NULL;
+    for (cache_entry_t *e = cache_entries; e != NULL; e = e->next) {
+      if (e->refs == 0 && e->poly != NULL && (oldest == NULL || e->used < oldest->used)) {
+        oldest = e;
+      }
+    }
+    if (oldest == NULL) {
+      return;
+    }
+    cache_unlink(oldest);
+    cache_stats.bytes -= oldest->bytes;
+    cache_stats.evictions++;
+    poly_destroy(oldest->poly);
+    free(oldest);
+  }
+}
+
+const poly_t *poly_cache_acquire(enum poly_type type, int level)
+{
+  pthread_mutex_lock(&cache_lock);
+  cache_entry_t *entry = cache_entries;
+  while (entry != NULL && (entry->type != type || entry->level != level)) {
+    entry = entry->next;
+  }
+
+  if (entry != NULL) {
+    cache_stats.hits++;
+    entry->refs++;
+    entry->used = ++cache_tick;
+    if (entry->building) {
+      cache_stats.waits++;
+      while (entry->building) {
+        pthread_cond_wait(&cache_built, &cache_lock);
+      }
+    }
+    const poly_t *poly = entry->poly;
+    // a failed build is already unlinked, the last waiter frees it
+    if (poly == NULL && --entry->refs == 0) {
+      free(entry);
+    }
+    pthread_mutex_unlock(&cache_lock);
+    return poly;
+  }
+
+  entry = calloc(1, sizeof(cache_entry_t));
+  if (entry == NULL) {
+    pthread_mutex_unlock(&cache_lock);
+    return NULL;
+  }
+  *entry = (cache_entry_t){ cache_entries, type, level, NULL, true, 1, ++cache_tick, 0 };
+  cache_entries = entry;
+  cache_stats.misses++;
+  pthread_mutex_unlock(&cache_lock);
+
+  struct timespec t0, t1;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  poly_t *poly = poly_create(type, level);
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+
+  pthread_mutex_lock(&cache_lock);
+  cache_stats.build_seconds += (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+  entry->building = false;
+  entry->poly = poly;
+  if (poly == NULL) {
+    cache_unlink(entry);
+    if (--entry->refs == 0) {
+      free(entry);
+    }
+  } else {
+    int v_cap = poly->v_cap ? poly->v_cap : poly->v_len, t_cap = poly->t_cap ? poly->t_cap : poly->t_len;
+    entry->bytes = sizeof(poly_t) + (v_cap + t_cap) * sizeof(float) + poly->i_len * sizeof(int);
+    cache_stats.bytes += entry->bytes;
+    if (cache_budget > 0) {
+      cache_evict(cache_budget);
+    }
+  }
+  pthread_cond_broadcast(&cache_built);
+  pthread_mutex_unlock(&cache_lock);
+  return poly;
+}
+
+bool poly_cache_release(const poly_t *poly)
+{
+  if (poly == NULL) {
+    return false;
+  }
+  bool held = false;
+  pthread_mutex_lock(&cache_lock);
+  for (cache_entry_t *e = cache_entries; e != NULL; e = e->next) {
+    if (e->poly == poly) {
+      // an extra release would leave the entry unevictable for good
+      held = e->refs > 0;
+      e->refs -= held;
+      break;
+    }
+  }
+  if (cache_budget > 0) {
+    cache_evict(cache_budget);
+  }
+  pthread_mutex_unlock(&cache_lock);
+  return held;
+}
+
+void poly_cache_budget(size_t budget)
+{
+  pthread_mutex_lock(&cache_lock);
+  cache_budget = budget;
+  if (cache_budget > 0) {
+    cache_evict(cache_budget);
+  }
+  pthread_mutex_unlock(&cache_lock);
+}
+
+void poly_cache_clear(void)
+{
+  pthread_mutex_lock(&cache_lock);
+  cache_evict(0);
+  pthread_mutex_unlock(&cache_lock);
+}
+
+poly_cache_stats_t poly_cache_stats(void)
+{
+  pthread_mutex_lock(&cache_lock);
+  poly_cache_stats_t stats = cache_stats;
+  pthread_mutex_unlock(&cache_lock);
+  return stats;
+}
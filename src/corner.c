@@ -0,0 +1,269 @@
+/**
+ * 3dm - simple 3D mathematic library
+ *
+ * Copyright (C) 2013 Cedric Fung <cedric@vec.io>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *    3. Neither the name of the Cedric Fung nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+
+ * THIS SOFTWARE IS PROVIDED BY Cedric Fung "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Cedric Fung BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "3dm/corner.h"
+
+static corner_table_t *corner_table_alloc(enum poly_type type, int c_len, int v_len)
+{
+  corner_table_t *ct = calloc(1, sizeof(corner_table_t));
+  if (ct == NULL) {
+    return NULL;
+  }
+  ct->type = type;
+  ct->c_len = c_len;
+  ct->v_len = v_len;
+  ct->vertices = malloc(c_len * sizeof(int));
+  ct->opposites = malloc(c_len * sizeof(int));
+  ct->corners = malloc(v_len * sizeof(int));
+  if (ct->vertices == NULL || ct->opposites == NULL || ct->corners == NULL) {
+    corner_table_destroy(ct);
+    return NULL;
+  }
+  return ct;
+}
+
+void corner_table_destroy(corner_table_t *ct)
+{
+  free(ct->vertices);
+  free(ct->opposites);
+  free(ct->corners);
+  free(ct);
+}
+
+static inline unsigned int corner_hash(unsigned int a, unsigned int b, unsigned int c)
+{
+  unsigned int h = a * 0x9e3779b1u;
+  h = (h ^ (h >> 15) ^ b) * 0x85ebca77u;
+  h = (h ^ (h >> 13) ^ c) * 0xc2b2ae3du;
+  return h ^ (h >> 16);
+}
+
+static unsigned int corner_position(const float *v, int k)
+{
+  // -0 and 0 weld together
+  float f = v[k] + 0.0f;
+  unsigned int u;
+  memcpy(&u, &f, sizeof(u));
+  return u;
+}
+
+corner_table_t *corner_table_create(const poly_t *poly)
+{
+  int c_len = poly->i_len, p_len = poly->v_len / 3;
+  unsigned int cap = 1;
+  while (cap < 2u * (c_len > p_len ? c_len : p_len)) { cap <<= 1; }
+  // open addressing, one slot per poly vertex, then per directed edge
+  int *slots = malloc(cap * sizeof(int));
+  int *welded = malloc(p_len * sizeof(int));
+  if (slots == NULL || welded == NULL) {
+    free(slots); free(welded);
+    return NULL;
+  }
+
+  memset(slots, -1, cap * sizeof(int));
+  int v_len = 0;
+  for (int i = 0; i < p_len; i++) {
+    const float *v = poly->vertices + i * 3;
+    unsigned int a = corner_position(v, 0), b = corner_position(v, 1), c = corner_position(v, 2);
+    unsigned int h = corner_hash(a, b, c) & (cap - 1);
+    for (;; h = (h + 1) & (cap - 1)) {
+      int j = slots[h];
+      if (j < 0) {
+        slots[h] = i;
+        welded[i] = v_len++;
+        break;
+      }
+      const float *w = poly->vertices + j * 3;
+      if (a == corner_position(w, 0) && b == corner_position(w, 1) && c == corner_position(w, 2)) {
+        welded[i] = welded[j];
+        break;
+      }
+    }
+  }
+
+  corner_table_t *ct = corner_table_alloc(poly->type, c_len, v_len);
+  if (ct == NULL) {
+    free(slots); free(welded);
+    return NULL;
+  }
+  for (int c = 0; c < c_len; c++) {
+    ct->vertices[c] = welded[poly->indices[c]];
+    ct->corners[ct->vertices[c]] = c;
+  }
+  free(welded);
+
+  // the edge facing corner c goes from next(c) to prev(c), its opposite is
+  // the corner whose edge goes the other way
+  memset(slots, -1, cap * sizeof(int));
+  const int *vs = ct->vertices;
+  for (int c = 0; c < c_len; c++) {
+    int a = vs[corner_next(c)], b = vs[corner_prev(c)];
+    unsigned int h = corner_hash(a, b, 0) & (cap - 1);
+    while (slots[h] >= 0 && (vs[corner_next(slots[h])] != a || vs[corner_prev(slots[h])] != b)) {
+      h = (h + 1) & (cap - 1);
+    }
+    if (slots[h] < 0) {
+      slots[h] = c;
+    }
+  }
+  for (int c = 0; c < c_len; c++) {
+    int a = vs[corner_prev(c)], b = vs[corner_next(c)];
+    unsigned int h = corner_hash(a, b, 0) & (cap - 1);
+    while (slots[h] >= 0 && (vs[corner_next(slots[h])] != a || vs[corner_prev(slots[h])] != b)) {
+      h = (h + 1) & (cap - 1);
+    }
+    ct->opposites[c] = slots[h];
+  }
+
+  free(slots);
+  return ct;
+}
+
+bool corner_table_subdivide(corner_table_t *ct, int levels)
+{
+  if (ct->type != POLY_ICOSAHEDRON || levels < 0) {
+    return false;
+  }
+
+  for (int l = 0; l < levels; l++) {
+    // Triangle t of T keeps its first corner in child t, the other children
+    // are T + 3t (second corner), T + 3t + 1 (third corner) and T + 3t + 2
+    // (the midpoints), as icosahedron_recur lays them out. Child j of a
+    // corner is (corner j, midpoint j j+1, midpoint j+2 j) with the
+    // midpoint of the edge facing corner k numbered like that corner.
+    int t_len = ct->c_len / 3, c_len = ct->c_len * 4;
+    int *mid = malloc(ct->c_len * sizeof(int));
+    int *vertices = malloc(c_len * sizeof(int));
+    int *opposites = malloc(c_len * sizeof(int));
+    int v_len = ct->v_len + ct->c_len / 2;
+    int *corners = realloc(ct->corners, (v_len + ct->c_len) * sizeof(int));
+    if (mid == NULL || vertices == NULL || opposites == NULL || corners == NULL) {
+      free(mid); free(vertices); free(opposites);
+      if (corners != NULL) { ct->corners = corners; }
+      return false;
+    }
+    ct->corners = corners;
+
+    v_len = ct->v_len;
+    for (int c = 0; c < ct->c_len; c++) {
+      int o = ct->opposites[c];
+      mid[c] = o < 0 || c < o ? v_len++ : mid[o];
+    }
+
+    for (int t = 0; t < t_len; t++) {
+      const int *v = ct->vertices + 3 * t, *m = mid + 3 * t, *o = ct->opposites + 3 * t;
+      int child[4] = {t, t_len + 3 * t, t_len + 3 * t + 1, t_len + 3 * t + 2};
+      int c3 = 3 * child[3];
+      for (int j = 0; j < 3; j++) {
+        int c = 3 * child[j];
+        // midpoint j j+1 faces corner j+2
+        vertices[c] = v[j];
+        vertices[c + 1] = m[(j + 2) % 3];
+        vertices[c + 2] = m[(j + 1) % 3];
+        vertices[c3 + j] = m[(j + 2) % 3];
+        opposites[c] = c3 + (j + 1) % 3;
+        opposites[c3 + (j + 1) % 3] = c;
+      }
+      for (int k = 0; k < 3; k++) {
+        // the halves of the edge facing corner k, next to corner k+1 and
+        // corner k+2, against the same halves across it
+        int a = 3 * child[(k + 1) % 3] + 2, b = 3 * child[(k + 2) % 3] + 1;
+        if (o[k] < 0) {
+          opposites[a] = opposites[b] = -1;
+          continue;
+        }
+        int u = o[k] / 3, n = o[k] % 3;
+        int un[3] = {u, t_len + 3 * u, t_len + 3 * u + 1};
+        opposites[a] = 3 * un[(n + 2) % 3] + 1;
+        opposites[b] = 3 * un[(n + 1) % 3] + 2;
+      }
+    }
+
+    for (int c = 0; c < c_len; c++) {
+      ct->corners[vertices[c]] = c;
+    }
+    free(mid);
+    free(ct->vertices);
+    free(ct->opposites);
+    ct->vertices = vertices;
+    ct->opposites = opposites;
+    ct->c_len = c_len;
+    ct->v_len = v_len;
+  }
+  return true;
+}
+
+int corner_table_ring(const corner_table_t *ct, int c, int *ring, int max)
+{
+  // on a border start from the corner next to it
+  int start = c, n = 0;
+  for (int p = ct->opposites[corner_prev(c)]; p >= 0; p = ct->opposites[corner_prev(c)]) {
+    p = corner_prev(p);
+    if (p == start) {
+      break;
+    }
+    c = p;
+  }
+
+  for (int first = c;;) {
+    if (n < max) { ring[n] = ct->vertices[corner_next(c)]; }
+    n++;
+    int s = corner_swing(ct, c);
+    if (s < 0) {
+      if (n < max) { ring[n] = ct->vertices[corner_prev(c)]; }
+      return n + 1;
+    }
+    if (s == first) {
+      return n;
+    }
+    c = s;
+  }
+}
+
+bool corner_table_seam(const corner_table_t *ct, const poly_t *poly, int c)
+{
+  int o = ct->opposites[c];
+  if (o < 0) {
+    return true;
+  }
+  const int *is = poly->indices;
+  const float *ts = poly->texcoords;
+  int a[2] = {is[corner_next(c)], is[corner_prev(c)]}, b[2] = {is[corner_prev(o)], is[corner_next(o)]};
+  for (int k = 0; k < 2; k++) {
+    if (fabsf(ts[2 * a[k]] - ts[2 * b[k]]) > 1e-6f || fabsf(ts[2 * a[k] + 1] - ts[2 * b[k] + 1]) > 1e-6f) {
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,191 @@
+/**
+ * 3dm - simple 3D mathematic library
+ *
+ * Copyright (C) 2013 Cedric Fung <cedric@vec.io>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *    3. Neither the name of the Cedric Fung nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+
+ * THIS SOFTWARE IS PROVIDED BY Cedric Fung "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Cedric Fung BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <float.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include "3dm/poly.h"
+
+#define EXPORT_STAGING (1 << 20)
+
+static bool export_writev(int fd, struct iovec *iov, int n)
+{
+  while (n > 0) {
+    ssize_t w = writev(fd, iov, n > IOV_MAX ? IOV_MAX : n);
+    if (w < 0) {
+      if (errno == EINTR) { continue; }
+      return false;
+    }
+    while (n > 0 && (size_t)w >= iov->iov_len) {
+      w -= iov->iov_len;
+      iov++;
+      n--;
+    }
+    if (n > 0) {
+      iov->iov_base = (char *)iov->iov_base + w;
+      iov->iov_len -= w;
+    }
+  }
+  return true;
+}
+
+static bool export_write(int fd, const void *buf, size_t len)
+{
+  struct iovec iov = { (void *)buf, len };
+  return export_writev(fd, &iov, 1);
+}
+
+bool poly_write_ply(const poly_t *poly, int fd)
+{
+  int vn = poly->v_len / 3, fn = poly->i_len / 3;
+  bool texcoords = poly->texcoords != NULL && poly->t_len / 2 >= vn;
+  char header[512];
+  int hl = snprintf(header, sizeof(header),
+      "ply\nformat %s 1.0\ncomment 3dm\nelement vertex %d\n"
+      "property float x\nproperty float y\nproperty float z\n%s"
+      "element face %d\nproperty list uchar int vertex_indices\nend_header\n",
+      __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__ ? "binary_big_endian" : "binary_little_endian",
+      vn, texcoords ? "property float s\nproperty float t\n" : "", fn);
+  if (!export_write(fd, header, hl)) {
+    return false;
+  }
+
+  char *staging = malloc(EXPORT_STAGING);
+  if (staging == NULL) {
+    return false;
+  }
+  bool ok = true;
+  size_t stride = texcoords ? 5 * sizeof(float) : 3 * sizeof(float);
+  int batch = EXPORT_STAGING / stride;
+  for (int i = 0; i < vn && ok; i += batch) {
+    int n = vn - i < batch ? vn - i : batch;
+    char *p = staging;
+    for (int j = i; j < i + n; j++, p += stride) {
+      memcpy(p, poly->vertices + j * 3, 3 * sizeof(float));
+      if (texcoords) {
+        memcpy(p + 3 * sizeof(float), poly->texcoords + j * 2, 2 * sizeof(float));
+      }
+    }
+    ok = export_write(fd, staging, p - staging);
+  }
+
+  stride = 1 + 3 * sizeof(int);
+  batch = EXPORT_STAGING / stride;
+  for (int i = 0; i < fn && ok; i += batch) {
+    int n = fn - i < batch ? fn - i : batch;
+    char *p = staging;
+    for (int j = i; j < i + n; j++, p += stride) {
+      *p = 3;
+      memcpy(p + 1, poly->indices + j * 3, 3 * sizeof(int));
+    }
+    ok = export_write(fd, staging, p - staging);
+  }
+
+  free(staging);
+  return ok;
+}
+
+bool poly_export_ply(const poly_t *poly, const char *path)
+{
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    return false;
+  }
+  bool ok = poly_write_ply(poly, fd);
+  return close(fd) == 0 && ok;
+}
+
+bool poly_write_gltf_bin(const poly_t *poly, int fd)
+{
+  struct iovec iov[3] = {
+    { poly->vertices, poly->v_len * sizeof(float) },
+    { poly->texcoords, poly->t_len * sizeof(float) },
+    { poly->indices, poly->i_len * sizeof(int) },
+  };
+  return export_writev(fd, iov, 3);
+}
+
+bool poly_export_gltf(const poly_t *poly, const char *path, const char *bin_path)
+{
+  float min[3] = {FLT_MAX, FLT_MAX, FLT_MAX}, max[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+  for (int i = 0; i < poly->v_len; i++) {
+    float v = poly->vertices[i];
+    min[i % 3] = v < min[i % 3] ? v : min[i % 3];
+    max[i % 3] = v > max[i % 3] ? v : max[i % 3];
+  }
+  if (poly->v_len == 0) {
+    memset(min, 0, sizeof(min));
+    memset(max, 0, sizeof(max));
+  }
+
+  const char *uri = strrchr(bin_path, '/') ? strrchr(bin_path, '/') + 1 : bin_path;
+  long vb = poly->v_len * sizeof(float), tb = poly->t_len * sizeof(float), ib = poly->i_len * sizeof(int);
+  FILE *f = fopen(path, "w");
+  if (f == NULL) {
+    return false;
+  }
+  fprintf(f, "{\n  \"asset\": {\"version\": \"2.0\", \"generator\": \"3dm\"},\n");
+  fprintf(f, "  \"buffers\": [{\"uri\": \"");
+  for (const char *c = uri; *c; c++) {
+    if (*c == '"' || *c == '\\') { fputc('\\', f); }
+    fputc(*c, f);
+  }
+  fprintf(f, "\", \"byteLength\": %ld}],\n", vb + tb + ib);
+  fprintf(f, "  \"bufferViews\": [\n"
+      "    {\"buffer\": 0, \"byteOffset\": 0, \"byteLength\": %ld, \"target\": 34962},\n"
+      "    {\"buffer\": 0, \"byteOffset\": %ld, \"byteLength\": %ld, \"target\": 34962},\n"
+      "    {\"buffer\": 0, \"byteOffset\": %ld, \"byteLength\": %ld, \"target\": 34963}\n  ],\n",
+      vb, vb, tb, vb + tb, ib);
+  fprintf(f, "  \"accessors\": [\n"
+      "    {\"bufferView\": 0, \"componentType\": 5126, \"count\": %d, \"type\": \"VEC3\", "
+      "\"min\": [%.9g, %.9g, %.9g], \"max\": [%.9g, %.9g, %.9g]},\n"
+      "    {\"bufferView\": 1, \"componentType\": 5126, \"count\": %d, \"type\": \"VEC2\"},\n"
+      "    {\"bufferView\": 2, \"componentType\": 5125, \"count\": %d, \"type\": \"SCALAR\"}\n  ],\n",
+      poly->v_len / 3, min[0], min[1], min[2], max[0], max[1], max[2], poly->t_len / 2, poly->i_len);
+  fprintf(f, "  \"meshes\": [{\"primitives\": [{\"attributes\": {\"POSITION\": 0, \"TEXCOORD_0\": 1}, \"indices\": 2}]}],\n"
+      "  \"nodes\": [{\"mesh\": 0}],\n  \"scenes\": [{\"nodes\": [0]}],\n  \"scene\": 0\n}\n");
+  if (fclose(f) != 0) {
+    return false;
+  }
+
+  int fd = open(bin_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    return false;
+  }
+  bool ok = poly_write_gltf_bin(poly, fd);
+  return close(fd) == 0 && ok;
+}
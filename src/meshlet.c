@@ -0,0 +1,239 @@
+/**
+ * 3dm - simple 3D mathematic library
+ *
+ * Copyright (C) 2013 Cedric Fung <cedric@vec.io>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *    3. Neither the name of the Cedric Fung nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+
+ * THIS SOFTWARE IS PROVIDED BY Cedric Fung "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Cedric Fung BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "3dm/meshlet.h"
+#include "3dm/corner.h"
+
+typedef vector(float, 4) meshlet_v4f;
+
+static inline meshlet_v4f meshlet_vertex(const poly_t *poly, int i)
+{
+  const float *v = poly->vertices + i * 3;
+  return (meshlet_v4f){v[0], v[1], v[2], 0};
+}
+
+static inline float meshlet_dot(meshlet_v4f a, meshlet_v4f b)
+{
+  meshlet_v4f p = a * b;
+  return p[0] + p[1] + p[2] + p[3];
+}
+
+static inline meshlet_v4f meshlet_cross(meshlet_v4f a, meshlet_v4f b)
+{
+  return (meshlet_v4f){a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0], 0};
+}
+
+static void meshlet_bounds(const meshlets_t *m, meshlet_t *ml, const poly_t *poly)
+{
+  const int *vs = m->vertices + ml->v_offset;
+  const unsigned char *ts = m->triangles + ml->t_offset * 3;
+
+  meshlet_v4f lo = meshlet_vertex(poly, vs[0]), hi = lo;
+  for (int i = 1; i < ml->v_count; i++) {
+    meshlet_v4f p = meshlet_vertex(poly, vs[i]);
+    for (int k = 0; k < 3; k++) {
+      lo[k] = fminf(lo[k], p[k]);
+      hi[k] = fmaxf(hi[k], p[k]);
+    }
+  }
+  meshlet_v4f center = (lo + hi) * 0.5f;
+  float r2 = 0;
+  for (int i = 0; i < ml->v_count; i++) {
+    meshlet_v4f d = meshlet_vertex(poly, vs[i]) - center;
+    r2 = fmaxf(r2, meshlet_dot(d, d));
+  }
+
+  // the cone axis is the area weighted normal, its apex is behind every
+  // triangle plane so that seeing it from the back side of the cone means
+  // seeing all the triangles from their back
+  meshlet_v4f axis = {0};
+  for (int t = 0; t < ml->t_count * 3; t += 3) {
+    meshlet_v4f a = meshlet_vertex(poly, vs[ts[t]]);
+    axis += meshlet_cross(meshlet_vertex(poly, vs[ts[t + 1]]) - a, meshlet_vertex(poly, vs[ts[t + 2]]) - a);
+  }
+  float l = sqrtf(meshlet_dot(axis, axis));
+  axis = l > 0 ? axis / l : axis;
+  float min_dp = 1, max_t = 0;
+  for (int t = 0; t < ml->t_count * 3; t += 3) {
+    meshlet_v4f a = meshlet_vertex(poly, vs[ts[t]]);
+    meshlet_v4f n = meshlet_cross(meshlet_vertex(poly, vs[ts[t + 1]]) - a, meshlet_vertex(poly, vs[ts[t + 2]]) - a);
+    float nl = sqrtf(meshlet_dot(n, n));
+    if (nl == 0) {
+      continue;
+    }
+    n /= nl;
+    float dp = meshlet_dot(n, axis);
+    min_dp = fminf(min_dp, dp);
+    if (dp > 0) {
+      max_t = fmaxf(max_t, meshlet_dot(center - a, n) / dp);
+    }
+  }
+
+  meshlet_v4f apex = center - axis * max_t;
+  for (int k = 0; k < 3; k++) {
+    ml->center[k] = center[k];
+    ml->cone_axis[k] = axis[k];
+    ml->cone_apex[k] = apex[k];
+  }
+  ml->radius = sqrtf(r2);
+  ml->cone_cutoff = l > 0 && min_dp > 0.1f ? sqrtf(1 - min_dp * min_dp) : 2;
+}
+
+meshlets_t *meshlets_create(const poly_t *poly, int max_vertices, int max_triangles)
+{
+  int t_len = poly->i_len / 3, p_len = poly->v_len / 3;
+  if (max_vertices < 3 || max_vertices > 256 || max_triangles < 1 || t_len == 0) {
+    return NULL;
+  }
+  meshlets_t *m = calloc(1, sizeof(meshlets_t));
+  corner_table_t *ct = corner_table_create(poly);
+  // triangle -> meshlet, vertex -> local index and the triangles queued
+  int *owner = malloc(t_len * sizeof(int)), *local = malloc(p_len * sizeof(int));
+  int *queue = malloc(t_len * sizeof(int)), *queued = malloc(t_len * sizeof(int));
+  if (m != NULL) {
+    m->meshlets = malloc(t_len * sizeof(meshlet_t));
+    m->vertices = malloc(poly->i_len * sizeof(int));
+    m->triangles = malloc(poly->i_len);
+  }
+  if (m == NULL || ct == NULL || owner == NULL || local == NULL || queue == NULL || queued == NULL ||
+      m->meshlets == NULL || m->vertices == NULL || m->triangles == NULL) {
+    if (m != NULL) { meshlets_destroy(m); }
+    if (ct != NULL) { corner_table_destroy(ct); }
+    free(owner); free(local); free(queue); free(queued);
+    return NULL;
+  }
+  memset(owner, -1, t_len * sizeof(int));
+  memset(local, -1, p_len * sizeof(int));
+  memset(queued, -1, t_len * sizeof(int));
+
+  int scan = 0, seed = 0;
+  while (seed >= 0) {
+    meshlet_t *ml = m->meshlets + m->m_len;
+    *ml = (meshlet_t){ .v_offset = m->v_len, .t_offset = m->t_len / 3 };
+    int head = 0, tail = 0, next_seed = -1;
+    queue[tail++] = seed;
+    queued[seed] = m->m_len;
+
+    while (head < tail && ml->t_count < max_triangles) {
+      int t = queue[head++];
+      const int *is = poly->indices + t * 3;
+      int added = (local[is[0]] < 0) + (local[is[1]] < 0 && is[1] != is[0]) +
+                  (local[is[2]] < 0 && is[2] != is[0] && is[2] != is[1]);
+      if (ml->v_count + added > max_vertices) {
+        // left for the next meshlet, which starts next to this one
+        next_seed = next_seed < 0 ? t : next_seed;
+        continue;
+      }
+      owner[t] = m->m_len;
+      for (int k = 0; k < 3; k++) {
+        if (local[is[k]] < 0) {
+          local[is[k]] = ml->v_count++;
+          m->vertices[m->v_len++] = is[k];
+        }
+        m->triangles[m->t_len++] = local[is[k]];
+        int o = ct->opposites[t * 3 + k];
+        if (o >= 0 && owner[o / 3] < 0 && queued[o / 3] != m->m_len) {
+          queued[o / 3] = m->m_len;
+          queue[tail++] = o / 3;
+        }
+      }
+      ml->t_count++;
+    }
+    for (int i = head; i < tail && next_seed < 0; i++) {
+      next_seed = owner[queue[i]] < 0 ? queue[i] : -1;
+    }
+    for (int i = 0; i < ml->v_count; i++) {
+      local[m->vertices[ml->v_offset + i]] = -1;
+    }
+    meshlet_bounds(m, ml, poly);
+    m->m_len++;
+
+    while (next_seed < 0 && scan < t_len) {
+      next_seed = owner[scan] < 0 ? scan : -1;
+      scan++;
+    }
+    seed = next_seed;
+  }
+
+  corner_table_destroy(ct);
+  free(owner); free(local); free(queue); free(queued);
+  meshlet_t *shrunk = realloc(m->meshlets, m->m_len * sizeof(meshlet_t));
+  m->meshlets = shrunk != NULL ? shrunk : m->meshlets;
+  return m;
+}
+
+void meshlets_destroy(meshlets_t *m)
+{
+  free(m->meshlets);
+  free(m->vertices);
+  free(m->triangles);
+  free(m);
+}
+
+int meshlets_cull(const meshlets_t *m, mat4d view_projection, int *visible)
+{
+  // frustum planes are sums of the rows of the projection, pointing inside
+  meshlet_v4f planes[6];
+  for (int k = 0; k < 6; k++) {
+    vec4d p = vector_add(mat4d_row(view_projection, 3), vector_scale(mat4d_row(view_projection, k / 2), k % 2 ? -1 : 1));
+    double l = sqrt(p.ptr[0] * p.ptr[0] + p.ptr[1] * p.ptr[1] + p.ptr[2] * p.ptr[2]);
+    planes[k] = (meshlet_v4f){p.ptr[0] / l, p.ptr[1] / l, p.ptr[2] / l, p.ptr[3] / l};
+  }
+  // a point for perspective, a direction towards the far plane for ortho
+  vec4d c = mat4d_projection_center(view_projection);
+  meshlet_v4f eye = {c.ptr[0], c.ptr[1], c.ptr[2], 0};
+  bool ortho = c.ptr[3] == 0;
+
+  int n = 0;
+  for (int i = 0; i < m->m_len; i++) {
+    const meshlet_t *ml = m->meshlets + i;
+    meshlet_v4f center = {ml->center[0], ml->center[1], ml->center[2], 1};
+    bool inside = true;
+    for (int k = 0; k < 6 && inside; k++) {
+      inside = meshlet_dot(planes[k], center) >= -ml->radius;
+    }
+    if (!inside) {
+      continue;
+    }
+    if (ml->cone_cutoff <= 1) {
+      meshlet_v4f axis = {ml->cone_axis[0], ml->cone_axis[1], ml->cone_axis[2], 0};
+      meshlet_v4f view = ortho ? eye : (meshlet_v4f){ml->cone_apex[0], ml->cone_apex[1], ml->cone_apex[2], 0} - eye;
+      if (meshlet_dot(view, axis) >= ml->cone_cutoff * sqrtf(meshlet_dot(view, view))) {
+        continue;
+      }
+    }
+    visible[n++] = i;
+  }
+  return n;
+}
@@ -0,0 +1,364 @@
+/**
+ * 3dm - simple 3D mathematic library
+ *
+ * Copyright (C) 2013 Cedric Fung <cedric@vec.io>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *    3. Neither the name of the Cedric Fung nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+
+ * THIS SOFTWARE IS PROVIDED BY Cedric Fung "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Cedric Fung BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "3dm/occlusion.h"
+#include "parallel.h"
+
+#define OCCLUSION_LANES 8
+#define OCCLUSION_W_MIN 1e-6f
+
+typedef vector(float, OCCLUSION_LANES) v8f;
+typedef vector(int, OCCLUSION_LANES) v8i;
+
+typedef struct {
+  occlusion_t *o;
+  const poly_t *poly;
+  const float *screen; // x, y, z, w per vertex, w <= 0 if not drawable
+  const int *bins; // triangles of band b from starts[b] to starts[b + 1]
+  const int *starts;
+  int bands;
+} occlusion_job_t;
+
+static inline v8f v8f_select(v8i mask, v8f a, v8f b)
+{
+  return (v8f)((mask & (v8i)a) | (~mask & (v8i)b));
+}
+
+static inline bool v8i_any(v8i mask)
+{
+  for (int i = 0; i < OCCLUSION_LANES; i++) {
+    if (mask[i]) { return true; }
+  }
+  return false;
+}
+
+occlusion_t *occlusion_create(int width, int height)
+{
+  if (width <= 0 || height <= 0) {
+    return NULL;
+  }
+  occlusion_t *o = calloc(1, sizeof(occlusion_t));
+  if (o == NULL) {
+    return NULL;
+  }
+  o->width = width;
+  o->height = height;
+  o->tiles_x = (width + OCCLUSION_TILE - 1) / OCCLUSION_TILE;
+  o->tiles_y = (height + OCCLUSION_TILE - 1) / OCCLUSION_TILE;
+  o->pitch = o->tiles_x * OCCLUSION_TILE;
+  o->depth = aligned_alloc(sizeof(v8f), o->pitch * o->tiles_y * OCCLUSION_TILE * sizeof(float));
+  o->hiz = malloc(o->tiles_x * o->tiles_y * sizeof(float));
+  if (o->depth == NULL || o->hiz == NULL) {
+    occlusion_destroy(o);
+    return NULL;
+  }
+  occlusion_clear(o);
+  return o;
+}
+
+void occlusion_destroy(occlusion_t *o)
+{
+  free(o->depth);
+  free(o->hiz);
+  free(o);
+}
+
+void occlusion_clear(occlusion_t *o)
+{
+  for (int i = 0; i < o->pitch * o->tiles_y * OCCLUSION_TILE; i++) {
+    o->depth[i] = 1;
+  }
+  for (int i = 0; i < o->tiles_x * o->tiles_y; i++) {
+    o->hiz[i] = 1;
+  }
+}
+
+// plain compares, fminf and fmaxf are libm calls without -ffinite-math-only
+static inline float occlusion_min3(float a, float b, float c)
+{
+  float m = a < b ? a : b;
+  return c < m ? c : m;
+}
+
+static inline float occlusion_max3(float a, float b, float c)
+{
+  float m = a > b ? a : b;
+  return c > m ? c : m;
+}
+
+static void occlusion_triangle(occlusion_t *o, const float *a, const float *b, const float *c, int y_begin, int y_end)
+{
+  float area = (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+  if (fabsf(area) < 1e-12f) {
+    return;
+  }
+  int x0 = floorf(occlusion_min3(a[0], b[0], c[0]));
+  int x1 = ceilf(occlusion_max3(a[0], b[0], c[0]));
+  int y0 = floorf(occlusion_min3(a[1], b[1], c[1]));
+  int y1 = ceilf(occlusion_max3(a[1], b[1], c[1]));
+  if (x0 < 0) { x0 = 0; }
+  if (x1 > o->width) { x1 = o->width; }
+  if (y0 < y_begin) { y0 = y_begin; }
+  if (y1 > y_end) { y1 = y_end; }
+  if (x0 >= x1 || y0 >= y1) {
+    return;
+  }
+
+  // edge functions A x + B y + C, positive inside whatever the winding
+  const float *v[3] = {a, b, c};
+  float s = area > 0 ? 1 : -1, ea[3], eb[3], ec[3];
+  for (int k = 0; k < 3; k++) {
+    const float *p = v[(k + 1) % 3], *q = v[(k + 2) % 3];
+    ea[k] = -(q[1] - p[1]) * s;
+    eb[k] = (q[0] - p[0]) * s;
+    ec[k] = -(ea[k] * p[0] + eb[k] * p[1]);
+  }
+  // window depth is affine in screen space
+  float zx = ((b[2] - a[2]) * (c[1] - a[1]) - (c[2] - a[2]) * (b[1] - a[1])) / area;
+  float zy = ((c[2] - a[2]) * (b[0] - a[0]) - (b[2] - a[2]) * (c[0] - a[0])) / area;
+  float zc = a[2] - zx * a[0] - zy * a[1];
+
+  v8f lane = {0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f};
+  x0 &= ~(OCCLUSION_LANES - 1);
+  for (int y = y0; y < y1; y++) {
+    float py = y + 0.5f;
+    float *row = o->depth + y * o->pitch;
+    for (int x = x0; x < x1; x += OCCLUSION_LANES) {
+      v8f px = lane + (float)x;
+      v8i in = (ea[0] * px + eb[0] * py + ec[0] >= 0) &
+               (ea[1] * px + eb[1] * py + ec[1] >= 0) &
+               (ea[2] * px + eb[2] * py + ec[2] >= 0);
+      if (!v8i_any(in)) {
+        continue;
+      }
+      v8f z = zx * px + zy * py + zc, d;
+      memcpy(&d, row + x, sizeof(d));
+      d = v8f_select(in & (z < d), z, d);
+      memcpy(row + x, &d, sizeof(d));
+    }
+  }
+}
+
+// bands of tile rows triangle abc covers, false if it draws nothing
+static bool occlusion_triangle_bands(const occlusion_t *o, const int *band_of,
+                                     const float *a, const float *b, const float *c, int *lo, int *hi)
+{
+  if (a[3] <= 0 || b[3] <= 0 || c[3] <= 0) {
+    return false;
+  }
+  float x0 = occlusion_min3(a[0], b[0], c[0]), x1 = occlusion_max3(a[0], b[0], c[0]);
+  float y0 = occlusion_min3(a[1], b[1], c[1]), y1 = occlusion_max3(a[1], b[1], c[1]);
+  if (!(x1 >= 0 && x0 < o->width && y1 >= 0 && y0 < o->height)) {
+    return false;
+  }
+  *lo = band_of[y0 > 0 ? (int)y0 / OCCLUSION_TILE : 0];
+  *hi = band_of[y1 < o->height ? (int)y1 / OCCLUSION_TILE : o->tiles_y - 1];
+  return true;
+}
+
+static void occlusion_run(void *arg, int begin, int end)
+{
+  const occlusion_job_t *job = arg;
+  occlusion_t *o = job->o;
+  const int *is = job->poly->indices;
+  const float *sv = job->screen;
+
+  for (int band = begin; band < end; band++) {
+    int ty_begin = o->tiles_y * band / job->bands, ty_end = o->tiles_y * (band + 1) / job->bands;
+    for (int k = job->starts[band]; k < job->starts[band + 1]; k++) {
+      int i = job->bins[k] * 3;
+      occlusion_triangle(o, sv + is[i] * 4, sv + is[i + 1] * 4, sv + is[i + 2] * 4,
+                         ty_begin * OCCLUSION_TILE, ty_end * OCCLUSION_TILE);
+    }
+
+    for (int ty = ty_begin; ty < ty_end; ty++) {
+      for (int tx = 0; tx < o->tiles_x; tx++) {
+        v8f m = {0};
+        for (int y = 0; y < OCCLUSION_TILE; y++) {
+          v8f d;
+          memcpy(&d, o->depth + (ty * OCCLUSION_TILE + y) * o->pitch + tx * OCCLUSION_TILE, sizeof(d));
+          m = v8f_select(d > m, d, m);
+        }
+        float z = 0;
+        for (int k = 0; k < OCCLUSION_LANES; k++) {
+          z = fmaxf(z, m[k]);
+        }
+        o->hiz[ty * o->tiles_x + tx] = z;
+      }
+    }
+  }
+}
+
+bool occlusion_rasterize(occlusion_t *o, const poly_t *poly, mat4d model_view_projection, int threads)
+{
+  // one band of tile rows per thread
+  int bands = threads < 1 ? 1 : threads > o->tiles_y ? o->tiles_y : threads;
+  int len = poly->v_len / 3, t_len = poly->i_len / 3;
+  float *screen = malloc(len * 4 * sizeof(float));
+  int *band_of = malloc(o->tiles_y * sizeof(int));
+  int *starts = calloc(bands + 1, sizeof(int));
+  int *spans = malloc((t_len > 0 ? t_len : 1) * 2 * sizeof(int));
+  if (screen == NULL || band_of == NULL || starts == NULL || spans == NULL) {
+    free(screen); free(band_of); free(starts); free(spans);
+    return false;
+  }
+
+  mat4f m = mat4d_to_mat4f(model_view_projection);
+  for (int i = 0; i < len; i++) {
+    const float *v = poly->vertices + i * 3;
+    float *s = screen + i * 4;
+    float c[4];
+    for (int r = 0; r < 4; r++) {
+      c[r] = m.ptr[4 * r] * v[0] + m.ptr[4 * r + 1] * v[1] + m.ptr[4 * r + 2] * v[2] + m.ptr[4 * r + 3];
+    }
+    // in front of the near plane only
+    s[3] = c[3] > OCCLUSION_W_MIN && c[2] >= -c[3] ? c[3] : 0;
+    float w = 1 / c[3];
+    s[0] = (c[0] * w * 0.5f + 0.5f) * o->width;
+    s[1] = (0.5f - c[1] * w * 0.5f) * o->height;
+    s[2] = c[2] * w * 0.5f + 0.5f;
+  }
+
+  // Bin the triangles by band in a single pass over them, keeping the first
+  // and last band of each to fill the bins, so a band walks only the
+  // triangles reaching it instead of all of them.
+  for (int b = 0; b < bands; b++) {
+    for (int ty = o->tiles_y * b / bands; ty < o->tiles_y * (b + 1) / bands; ty++) {
+      band_of[ty] = b;
+    }
+  }
+  const int *is = poly->indices;
+  for (int t = 0; t < t_len; t++) {
+    int *span = spans + t * 2;
+    if (!occlusion_triangle_bands(o, band_of, screen + is[3 * t] * 4, screen + is[3 * t + 1] * 4,
+                                  screen + is[3 * t + 2] * 4, span, span + 1)) {
+      span[0] = 0; span[1] = -1;
+    }
+    for (int b = span[0]; b <= span[1]; b++) {
+      starts[b + 1]++;
+    }
+  }
+  for (int b = 0; b < bands; b++) {
+    starts[b + 1] += starts[b];
+  }
+  int *bins = malloc((starts[bands] > 0 ? starts[bands] : 1) * sizeof(int));
+  if (bins == NULL) {
+    free(screen); free(band_of); free(starts); free(spans);
+    return false;
+  }
+  int fill[bands];
+  memcpy(fill, starts, sizeof(fill));
+  for (int t = 0; t < t_len; t++) {
+    for (int b = spans[t * 2]; b <= spans[t * 2 + 1]; b++) {
+      bins[fill[b]++] = t;
+    }
+  }
+
+  occlusion_job_t job = { o, poly, screen, bins, starts, bands };
+  parallel_for(occlusion_run, &job, bands, bands);
+
+  free(screen);
+  free(band_of);
+  free(starts);
+  free(spans);
+  free(bins);
+  return true;
+}
+
+// true if some pixel of [x0, x1) x [y0, y1) is not in front of z
+static bool occlusion_rect_visible(const occlusion_t *o, int x0, int y0, int x1, int y1, float z)
+{
+  for (int ty = y0 / OCCLUSION_TILE; ty * OCCLUSION_TILE < y1; ty++) {
+    for (int tx = x0 / OCCLUSION_TILE; tx * OCCLUSION_TILE < x1; tx++) {
+      if (o->hiz[ty * o->tiles_x + tx] < z) {
+        continue;
+      }
+      int ya = ty * OCCLUSION_TILE > y0 ? ty * OCCLUSION_TILE : y0;
+      int yb = (ty + 1) * OCCLUSION_TILE < y1 ? (ty + 1) * OCCLUSION_TILE : y1;
+      int xa = tx * OCCLUSION_TILE > x0 ? tx * OCCLUSION_TILE : x0;
+      int xb = (tx + 1) * OCCLUSION_TILE < x1 ? (tx + 1) * OCCLUSION_TILE : x1;
+      for (int y = ya; y < yb; y++) {
+        for (int x = xa; x < xb; x++) {
+          if (o->depth[y * o->pitch + x] >= z) {
+            return true;
+          }
+        }
+      }
+    }
+  }
+  return false;
+}
+
+int occlusion_test_boxes(const occlusion_t *o, mat4d view_projection, const float *boxes, int n, bool *visible)
+{
+  mat4f m = mat4d_to_mat4f(view_projection);
+  int count = 0;
+  for (int i = 0; i < n; i++) {
+    const float *box = boxes + i * 6;
+    float x0 = INFINITY, y0 = INFINITY, x1 = -INFINITY, y1 = -INFINITY, z0 = INFINITY;
+    int behind = 0;
+    for (int k = 0; k < 8; k++) {
+      float p[3] = { box[k & 1 ? 3 : 0], box[k & 2 ? 4 : 1], box[k & 4 ? 5 : 2] }, c[4];
+      for (int r = 0; r < 4; r++) {
+        c[r] = m.ptr[4 * r] * p[0] + m.ptr[4 * r + 1] * p[1] + m.ptr[4 * r + 2] * p[2] + m.ptr[4 * r + 3];
+      }
+      if (c[3] <= OCCLUSION_W_MIN || c[2] < -c[3]) {
+        behind++;
+        continue;
+      }
+      float w = 1 / c[3];
+      float x = (c[0] * w * 0.5f + 0.5f) * o->width, y = (0.5f - c[1] * w * 0.5f) * o->height;
+      x0 = fminf(x0, x); x1 = fmaxf(x1, x);
+      y0 = fminf(y0, y); y1 = fmaxf(y1, y);
+      z0 = fminf(z0, c[2] * w * 0.5f + 0.5f);
+    }
+
+    // a box crossing the near plane is kept, one outside the view is not
+    if (behind == 8) {
+      visible[i] = false;
+    } else if (behind > 0) {
+      visible[i] = true;
+    } else if (x1 < 0 || y1 < 0 || x0 > o->width || y0 > o->height || z0 > 1) {
+      visible[i] = false;
+    } else {
+      int xa = x0 > 0 ? floorf(x0) : 0, ya = y0 > 0 ? floorf(y0) : 0;
+      int xb = x1 < o->width ? ceilf(x1) : o->width, yb = y1 < o->height ? ceilf(y1) : o->height;
+      if (xb <= xa) { xb = xa + 1 < o->width ? xa + 1 : o->width; xa = xb - 1; }
+      if (yb <= ya) { yb = ya + 1 < o->height ? ya + 1 : o->height; ya = yb - 1; }
+      visible[i] = occlusion_rect_visible(o, xa, ya, xb, yb, z0);
+    }
+    count += visible[i];
+  }
+  return count;
+}
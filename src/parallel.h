@@ -0,0 +1,80 @@
+/**
+ * 3dm - simple 3D mathematic library
+ *
+ * Copyright (C) 2013 Cedric Fung <cedric@vec.io>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *    3. Neither the name of the Cedric Fung nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+
+ * THIS SOFTWARE IS PROVIDED BY Cedric Fung "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Cedric Fung BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef _3DM_PARALLEL_H
+#define _3DM_PARALLEL_H
+#include <pthread.h>
+
+// Internal to the library, not installed with the headers in include/3dm.
+
+typedef struct {
+  void (*fn)(void *ctx, int begin, int end);
+  void *ctx;
+  int begin, end;
+} parallel_job_t;
+
+static inline void *parallel_job_run(void *arg)
+{
+  parallel_job_t *job = arg;
+  job->fn(job->ctx, job->begin, job->end);
+  return NULL;
+}
+
+// Runs fn over [0, len) split into one range per thread, the calling thread
+// takes the first range and the ranges of threads that failed to start.
+static inline void parallel_for(void (*fn)(void *, int, int), void *ctx, int len, int threads)
+{
+  if (threads > len) { threads = len; }
+  if (threads <= 1) {
+    fn(ctx, 0, len);
+    return;
+  }
+
+  pthread_t tids[threads];
+  parallel_job_t jobs[threads];
+  int started = 1;
+  for (int t = 0; t < threads; t++) {
+    jobs[t] = (parallel_job_t){ fn, ctx, (long)len * t / threads, (long)len * (t + 1) / threads };
+  }
+  for (int t = 1; t < threads; t++, started++) {
+    if (pthread_create(&tids[t], NULL, parallel_job_run, &jobs[t]) != 0) {
+      break;
+    }
+  }
+  for (int t = started; t < threads; t++) {
+    parallel_job_run(&jobs[t]);
+  }
+  parallel_job_run(&jobs[0]);
+  for (int t = 1; t < started; t++) {
+    pthread_join(tids[t], NULL);
+  }
+}
+
+#endif
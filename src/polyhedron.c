@@ -31,6 +31,7 @@
 #define _GNU_SOURCE
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include <stdio.h>
 #include <math.h>
 #include "3dm/3dm.h"
@@ -74,31 +75,29 @@ static bool texcoords_overlap_fix(poly_t *poly, int i1, int i2)
   return true;
 }
 
-static bool texcoords_calculate(poly_t *poly)
+static void texcoord_calculate(poly_t *poly, int i)
 {
-  float x, y, z;
-  poly->t_len = poly->v_len / 3 * 2;
-  poly->texcoords = malloc(poly->t_len * sizeof(float));
-  if (poly->texcoords == NULL) {
-    return false;
-  }
-
-  for (int i = 0; i < poly->v_len / 3; i++) {
-    x = poly->vertices[3*i];
-    y = poly->vertices[3*i+1];
-    z = poly->vertices[3*i+2];
-    poly->texcoords[2*i] = (1.0f + atan2f(y, x) / M_PI) * 0.5f;
-    switch (poly->type) {
-      case POLY_ICOSAHEDRON:
-        poly->texcoords[2*i+1] = (1 - asinf(z) * 2 / M_PI) * 0.5f;
-        break;
-      case POLY_CUBE:
-      default:
-        poly->texcoords[2*i+1] = (1 - z * sqrt(2)) * 0.5f;
-    }
+  float x = poly->vertices[3*i];
+  float y = poly->vertices[3*i+1];
+  float z = poly->vertices[3*i+2];
+  poly->texcoords[2*i] = (1.0f + atan2f(y, x) / M_PI) * 0.5f;
+  switch (poly->type) {
+    case POLY_ICOSAHEDRON:
+      poly->texcoords[2*i+1] = (1 - asinf(z) * 2 / M_PI) * 0.5f;
+      break;
+    case POLY_CUBE:
+    default:
+      poly->texcoords[2*i+1] = (1 - z * sqrt(2)) * 0.5f;
   }
+}
 
+// seam fix of the triangles flagged in seam, all of them if it is NULL
+static bool texcoords_seam_fix(poly_t *poly, const unsigned char *seam)
+{
   for (int i = 0; i < poly->i_len; i += 3) {
+    if (seam != NULL && !seam[i / 3]) {
+      continue;
+    }
     if (!texcoords_overlap_fix(poly, i, i+1) ||
         !texcoords_overlap_fix(poly, i, i+2) ||
         !texcoords_overlap_fix(poly, i+1, i+2)) {
@@ -108,18 +107,93 @@ static bool texcoords_calculate(poly_t *poly)
   return true;
 }
 
+// Whether the children of triangle t may straddle the seam. They can't if
+// t keeps away from it and spans little, as midpoints lie between their
+// ends in longitude and a triangle around a pole spans at least half a turn.
+static bool texcoords_near_seam(const poly_t *poly, int t)
+{
+  const float *ts = poly->texcoords;
+  const int *is = poly->indices + t * 3;
+  float u0 = ts[is[0]*2], u1 = ts[is[1]*2], u2 = ts[is[2]*2];
+  float lo = fminf(u0, fminf(u1, u2)), hi = fmaxf(u0, fmaxf(u1, u2));
+  return lo < 0.05f || hi > 0.95f || hi - lo > 0.25f;
+}
+
+// texcoords of the vertices from the given one on, the others are kept,
+// the buffers were sized by poly_reserve
+static bool texcoords_calculate(poly_t *poly, int from, const unsigned char *seam)
+{
+  poly->t_len = poly->v_len / 3 * 2;
+  for (int i = from; i < poly->v_len / 3; i++) {
+    texcoord_calculate(poly, i);
+  }
+  return texcoords_seam_fix(poly, seam);
+}
+
+// Sizes the buffers once for the given final lengths, with the slack the
+// seam copies appended by texcoords_overlap_fix usually need.
+static bool poly_reserve(poly_t *poly, int v_len, int i_len)
+{
+  int cap = v_len / 3 + (64 + v_len / 3) / 64;
+  float *vs = realloc(poly->vertices, cap * 3 * sizeof(float));
+  if (vs == NULL) { return false; }
+  poly->vertices = vs;
+  float *ts = realloc(poly->texcoords, cap * 2 * sizeof(float));
+  if (ts == NULL) { return false; }
+  poly->texcoords = ts;
+  int *is = realloc(poly->indices, i_len * sizeof(int));
+  if (is == NULL) { return false; }
+  poly->indices = is;
+  poly->v_cap = cap * 3;
+  poly->t_cap = cap * 2;
+  return true;
+}
+
+// lengths after the given number of icosahedron_recur or cube_recur calls,
+// false if they or the caps poly_reserve derives from them overflow an int
+static bool poly_recur_lengths(enum poly_type type, int levels, int *v_len, int *i_len)
+{
+  long long v = *v_len, i = *i_len;
+  for (int k = 0; k < levels; k++) {
+    if (type == POLY_ICOSAHEDRON) {
+      v += i * 3;
+      i *= 4;
+    } else {
+      v += i - 12;
+      i = i * 2 - 12;
+    }
+    if (i > INT_MAX || v + v / 64 + 192 > INT_MAX) {
+      return false;
+    }
+  }
+  *v_len = v;
+  *i_len = i;
+  return true;
+}
+
+// passes the seam flags of the t_len triangles to their children, laid out
+// as by icosahedron_recur or cube_recur (which leaves the caps alone)
+static void poly_recur_seam(enum poly_type type, unsigned char *seam, int t_len)
+{
+  if (type == POLY_ICOSAHEDRON) {
+    for (int t = 0; t < t_len; t++) {
+      seam[t_len + 3*t] = seam[t_len + 3*t + 1] = seam[t_len + 3*t + 2] = seam[t];
+    }
+    return;
+  }
+  for (int t = 4, k = t_len; t < t_len; t += 2, k += 2) {
+    seam[t] = seam[t+1] = seam[k] = seam[k+1] = seam[t] || seam[t+1];
+  }
+}
+
 static bool icosahedron_recur(poly_t *poly)
 {
   vec4d v1, v2, v3, v12, v23, v31;
   int i1, i2, i3, i12, i23, i31;
   int vdi = poly->v_len - 1, idi = poly->i_len - 1;
-  int vln = poly->i_len * 4, iln = poly->i_len * 4;
-  int *indices = realloc(poly->indices, iln * sizeof(int));
-  if (indices == NULL) { return false; }
-  poly->indices = indices;
-  float *vertices = realloc(poly->vertices, vln * sizeof(float));
-  if (vertices == NULL) { return false; }
-  poly->vertices = vertices;
+  int vln = poly->v_len + poly->i_len * 3, iln = poly->i_len * 4;
+  int *indices = poly->indices;
+  float *vertices = poly->vertices;
 
   for (int i = 0; i < poly->i_len; i += 3) {
     i1 = indices[i]; i2 = indices[i+1]; i3 = indices[i+2];
@@ -145,20 +219,22 @@ static bool icosahedron_recur(poly_t *poly)
   return true;
 }
 
+static const float icosahedron_vertices[36] = {
+  // [(0,+/-1, +/-phi), (+/-1, +/-phi, 0), (+/-phi, 0, +/-1)]
+  -1, M_PHI, 0, 1, M_PHI, 0, -1, -M_PHI, 0, 1, -M_PHI, 0,
+  0, -1, M_PHI, 0, 1, M_PHI, 0, -1, -M_PHI, 0, 1, -M_PHI,
+  M_PHI, 0, -1, M_PHI, 0, 1, -M_PHI, 0, -1, -M_PHI, 0, 1,
+};
+
+static const int icosahedron_indices[60] = {
+  0, 11, 5, 0, 5, 1, 0, 1, 7, 0, 7, 10, 0, 10, 11,
+  1, 5, 9, 5, 11, 4, 11, 10, 2, 10, 7, 6, 7, 1, 8,
+  3, 9, 4, 3, 4, 2, 3, 2, 6, 3, 6, 8, 3, 8, 9,
+  4, 9, 5, 2, 4, 11, 6, 2, 10, 8, 6, 7, 9, 8, 1,
+};
+
 static poly_t *icosahedron_create(poly_t *poly, int n)
 {
-  const float icosahedron_vertices[36] = {
-    // [(0,+/-1, +/-phi), (+/-1, +/-phi, 0), (+/-phi, 0, +/-1)]
-    -1, M_PHI, 0, 1, M_PHI, 0, -1, -M_PHI, 0, 1, -M_PHI, 0,
-    0, -1, M_PHI, 0, 1, M_PHI, 0, -1, -M_PHI, 0, 1, -M_PHI,
-    M_PHI, 0, -1, M_PHI, 0, 1, -M_PHI, 0, -1, -M_PHI, 0, 1,
-  };
-  const int icosahedron_indices[60] = {
-    0, 11, 5, 0, 5, 1, 0, 1, 7, 0, 7, 10, 0, 10, 11,
-    1, 5, 9, 5, 11, 4, 11, 10, 2, 10, 7, 6, 7, 1, 8,
-    3, 9, 4, 3, 4, 2, 3, 2, 6, 3, 6, 8, 3, 8, 9,
-    4, 9, 5, 2, 4, 11, 6, 2, 10, 8, 6, 7, 9, 8, 1,
-  };
   const float radius = vec4d_length((vec4d)vector_new(1, M_PHI));
 
   poly->vertices = malloc(sizeof(icosahedron_vertices));
@@ -178,13 +254,17 @@ static poly_t *icosahedron_create(poly_t *poly, int n)
   poly->i_len = sizeof(icosahedron_indices) / sizeof(int);
   memcpy(poly->indices, icosahedron_indices, sizeof(icosahedron_indices));
 
+  int v_len = poly->v_len, i_len = poly->i_len;
+  if (!poly_recur_lengths(POLY_ICOSAHEDRON, n, &v_len, &i_len) || !poly_reserve(poly, v_len, i_len)) {
+    return NULL;
+  }
   for (int i = 0; i < n; i++) {
     if (!icosahedron_recur(poly)) {
       return NULL;
     }
   }
 
-  if (!texcoords_calculate(poly)) {
+  if (!texcoords_calculate(poly, 0, NULL)) {
     return NULL;
   }
 
@@ -196,13 +276,9 @@ static bool cube_recur(poly_t *poly)
   vec4d v1, v2, v3, v4, v12, v34;
   int i1, i2, i3, i4, i12, i34;
   int vdi = poly->v_len - 1, idi = poly->i_len - 1;
-  int vln = poly->i_len * 2 - 12, iln = poly->i_len * 2 - 12;
-  int *indices = realloc(poly->indices, iln * sizeof(int));
-  if (indices == NULL) { return false; }
-  poly->indices = indices;
-  float *vertices = realloc(poly->vertices, vln * sizeof(float));
-  if (vertices == NULL) { return false; }
-  poly->vertices = vertices;
+  int vln = poly->v_len + poly->i_len - 12, iln = poly->i_len * 2 - 12;
+  int *indices = poly->indices;
+  float *vertices = poly->vertices;
 
   for (int i = 12; i < poly->i_len; i += 6) {
     i1 = indices[i]; i2 = indices[i+1]; i3 = indices[i+3]; i4 = indices[i+4];
@@ -262,19 +338,92 @@ static poly_t *cube_create(poly_t *poly, int n)
   poly->i_len = sizeof(cube_indices) / sizeof(int);
   memcpy(poly->indices, cube_indices, sizeof(cube_indices));
 
+  int v_len = poly->v_len, i_len = poly->i_len;
+  if (!poly_recur_lengths(POLY_CUBE, n, &v_len, &i_len) || !poly_reserve(poly, v_len, i_len)) {
+    return NULL;
+  }
   for (int i = 0; i < n; i++) {
     if (!cube_recur(poly)) {
       return NULL;
     }
   }
 
-  if (!texcoords_calculate(poly)) {
+  if (!texcoords_calculate(poly, 0, NULL)) {
     return NULL;
   }
 
   return poly;
 }
 
+static poly_t *cubesphere_create(poly_t *poly, int n)
+{
+  // Each face of the cube is a (2^n + 1)^2 grid warped by tan() so that the
+  // vertices are spread evenly over the sphere, faces don't share vertices,
+  // so no seam fix is needed. Texcoords place the faces in a 3x2 atlas:
+  // +X -X +Y on the first row, -Y +Z -Z on the second one.
+  const int cubesphere_axes[54] = {
+    // center, s, t with s x t == center
+    1, 0, 0, 0, 1, 0, 0, 0, 1,
+    -1, 0, 0, 0, 0, 1, 0, 1, 0,
+    0, 1, 0, 0, 0, 1, 1, 0, 0,
+    0, -1, 0, 1, 0, 0, 0, 0, 1,
+    0, 0, 1, 1, 0, 0, 0, 1, 0,
+    0, 0, -1, 0, 1, 0, 1, 0, 0,
+  };
+  // 6 * 4^13 * 6 indices would overflow an int
+  if (n < 0 || n > 12) {
+    return NULL;
+  }
+  int seg = 1 << n, row = seg + 1;
+  poly->v_len = 6 * row * row * 3;
+  poly->t_len = 6 * row * row * 2;
+  poly->i_len = 6 * seg * seg * 6;
+  poly->vertices = malloc(poly->v_len * sizeof(float));
+  poly->texcoords = malloc(poly->t_len * sizeof(float));
+  poly->indices = malloc(poly->i_len * sizeof(int));
+  float *warp = malloc(row * sizeof(float));
+  if (poly->vertices == NULL || poly->texcoords == NULL || poly->indices == NULL || warp == NULL) {
+    free(warp);
+    return NULL;
+  }
+
+  for (int i = 0; i < row; i++) {
+    warp[i] = tan(M_PI_4 * (2.0 * i / seg - 1));
+  }
+
+  float *vs = poly->vertices, *ts = poly->texcoords;
+  int *is = poly->indices;
+  for (int f = 0; f < 6; f++) {
+    const int *c = cubesphere_axes + f * 9, *s = c + 3, *t = c + 6;
+    float u0 = (f % 3) / 3.0f, v0 = (f / 3) / 2.0f;
+    for (int j = 0; j < row; j++) {
+      float b = warp[j];
+      for (int i = 0; i < row; i++) {
+        float a = warp[i];
+        // a and b swap roles on the neighbouring face, so sum them first
+        // for a shared edge to get the very same vertices on both faces
+        float l = 1.0f / sqrtf(1.0f + (a * a + b * b));
+        *vs++ = (c[0] + a * s[0] + b * t[0]) * l;
+        *vs++ = (c[1] + a * s[1] + b * t[1]) * l;
+        *vs++ = (c[2] + a * s[2] + b * t[2]) * l;
+        *ts++ = u0 + (float)i / seg / 3.0f;
+        *ts++ = v0 + (float)j / seg / 2.0f;
+      }
+    }
+    int base = f * row * row;
+    for (int j = 0; j < seg; j++) {
+      for (int i = 0; i < seg; i++) {
+        int i00 = base + j * row + i, i10 = i00 + 1, i01 = i00 + row, i11 = i01 + 1;
+        *is++ = i00; *is++ = i10; *is++ = i11;
+        *is++ = i00; *is++ = i11; *is++ = i01;
+      }
+    }
+  }
+
+  free(warp);
+  return poly;
+}
+
 poly_t *poly_create(enum poly_type type, int n)
 {
   poly_t *(*create)(poly_t *, int) = NULL;
@@ -283,11 +432,15 @@ poly_t *poly_create(enum poly_type type, int n)
     return NULL;
   }
   poly->type = type;
+  poly->level = n;
 
   switch (type) {
     case POLY_ICOSAHEDRON:
       create = icosahedron_create;
       break;
+    case POLY_CUBESPHERE:
+      create = cubesphere_create;
+      break;
     case POLY_CUBE:
     default:
       create = cube_create;
@@ -301,6 +454,171 @@ poly_t *poly_create(enum poly_type type, int n)
   return poly;
 }
 
+bool poly_subdivide(poly_t *poly, int levels)
+{
+  bool (*recur)(poly_t *) = NULL;
+  if (levels < 0 || poly->level < 0) {
+    return false;
+  }
+
+  switch (poly->type) {
+    case POLY_CUBESPHERE: {
+      // a grid has no coarser work to reuse, build the finer one aside
+      poly_t grid = *poly;
+      grid.vertices = NULL; grid.texcoords = NULL; grid.indices = NULL;
+      grid.v_cap = 0; grid.t_cap = 0;
+      if (cubesphere_create(&grid, poly->level + levels) == NULL) {
+        free(grid.vertices);
+        free(grid.texcoords);
+        free(grid.indices);
+        return false;
+      }
+      free(poly->vertices);
+      free(poly->texcoords);
+      free(poly->indices);
+      *poly = grid;
+      poly->level += levels;
+      return true;
+    }
+    case POLY_ICOSAHEDRON:
+      recur = icosahedron_recur;
+      break;
+    case POLY_CUBE:
+    default:
+      recur = cube_recur;
+  }
+
+  if (levels == 0) {
+    return true;
+  }
+  int from = poly->v_len / 3, v_len = poly->v_len, i_len = poly->i_len;
+  if (!poly_recur_lengths(poly->type, levels, &v_len, &i_len)) {
+    return false;
+  }
+  unsigned char *seam = malloc(i_len / 3);
+  if (seam == NULL || !poly_reserve(poly, v_len, i_len)) {
+    free(seam);
+    return false;
+  }
+
+  // only the children of triangles near the seam need the seam fix
+  for (int t = 0; t < poly->i_len / 3; t++) {
+    seam[t] = texcoords_near_seam(poly, t);
+  }
+  for (int i = 0; i < levels; i++) {
+    int t_len = poly->i_len / 3;
+    if (!recur(poly)) {
+      free(seam);
+      return false;
+    }
+    poly_recur_seam(poly->type, seam, t_len);
+    poly->level++;
+  }
+  bool ok = texcoords_calculate(poly, from, seam);
+  free(seam);
+  return ok;
+}
+
+static bool cubesphere_lod_indices(poly_lod_t *lod, int n)
+{
+  // a level k grid is every 2^(n-k)th row and column of the level n one
+  int row = (1 << n) + 1, len = 0;
+  for (int k = 0; k <= n; k++) {
+    len += 6 * 6 << (2 * k);
+  }
+  int *is = malloc(len * sizeof(int));
+  if (is == NULL) {
+    return false;
+  }
+  lod->poly->indices = is;
+  for (int k = 0; k <= n; k++) {
+    lod->i_offsets[k] = is - lod->poly->indices;
+    int seg = 1 << k, stride = 1 << (n - k);
+    for (int f = 0; f < 6; f++) {
+      int base = f * row * row;
+      for (int j = 0; j < seg; j++) {
+        for (int i = 0; i < seg; i++) {
+          int i00 = base + j * stride * row + i * stride, i10 = i00 + stride;
+          int i01 = i00 + stride * row, i11 = i01 + stride;
+          *is++ = i00; *is++ = i10; *is++ = i11;
+          *is++ = i00; *is++ = i11; *is++ = i01;
+        }
+      }
+    }
+  }
+  lod->i_offsets[n + 1] = len;
+  lod->poly->i_len = len;
+  return true;
+}
+
+poly_lod_t *poly_lod_create(enum poly_type type, int n)
+{
+  if (n < 0) {
+    return NULL;
+  }
+  poly_lod_t *lod = calloc(1, sizeof(poly_lod_t));
+  if (lod == NULL) {
+    return NULL;
+  }
+  lod->levels = n + 1;
+  lod->i_offsets = malloc((n + 2) * sizeof(int));
+  lod->poly = poly_create(type, type == POLY_CUBESPHERE ? n : 0);
+  if (lod->i_offsets == NULL || lod->poly == NULL) {
+    poly_lod_destroy(lod);
+    return NULL;
+  }
+
+  if (type == POLY_CUBESPHERE) {
+    free(lod->poly->indices);
+    lod->poly->indices = NULL;
+    if (!cubesphere_lod_indices(lod, n)) {
+      poly_lod_destroy(lod);
+      return NULL;
+    }
+    return lod;
+  }
+
+  // subdivision only appends vertices, so every level indexes a prefix of
+  // the finest vertices plus its own seam copies, the indices pile up
+  int *indices = NULL, len = 0;
+  for (int k = 0; k <= n; k++) {
+    int *is = NULL;
+    if ((k > 0 && !poly_subdivide(lod->poly, 1)) ||
+        (is = realloc(indices, (len + lod->poly->i_len) * sizeof(int))) == NULL) {
+      free(indices);
+      poly_lod_destroy(lod);
+      return NULL;
+    }
+    indices = is;
+    memcpy(indices + len, lod->poly->indices, lod->poly->i_len * sizeof(int));
+    lod->i_offsets[k] = len;
+    len += lod->poly->i_len;
+  }
+  lod->i_offsets[n + 1] = len;
+  free(lod->poly->indices);
+  lod->poly->indices = indices;
+  lod->poly->i_len = len;
+  return lod;
+}
+
+poly_t poly_lod_get(const poly_lod_t *lod, int level)
+{
+  poly_t poly = *lod->poly;
+  poly.level = level;
+  poly.indices += lod->i_offsets[level];
+  poly.i_len = lod->i_offsets[level + 1] - lod->i_offsets[level];
+  return poly;
+}
+
+void poly_lod_destroy(poly_lod_t *lod)
+{
+  if (lod->poly != NULL) {
+    poly_destroy(lod->poly);
+  }
+  free(lod->i_offsets);
+  free(lod);
+}
+
 void poly_destroy(poly_t *poly)
 {
   free(poly->vertices);
@@ -308,3 +626,396 @@ void poly_destroy(poly_t *poly)
   free(poly->texcoords);
   free(poly);
 }
+
+// Subdivision replaces triangle t of a level with T triangles by its corner
+// child at v1, and appends the corner children at v2 and v3 as T + 3t and
+// T + 3t + 1, and the center child as T + 3t + 2. Corner 0 of a triangle
+// is kept by its first child, so the corners of any coarser triangle are
+// still found in the finest indices.
+static bool icosahedron_uniform(const poly_t *poly)
+{
+  // adaptive meshes have no level, and no parent to child layout, past
+  // level 12 the index count no longer fits an int
+  return poly->type == POLY_ICOSAHEDRON && poly->level >= 0 && poly->level <= 12 &&
+    poly->i_len == 60 << (2 * poly->level);
+}
+
+static const float *icosahedron_corner(const poly_t *poly, int k, int t, int j)
+{
+  if (!icosahedron_uniform(poly)) {
+    return NULL;
+  }
+  if (k < poly->level && j > 0) {
+    t = 20 * (1 << (2 * k)) + 3 * t + j - 1;
+  }
+  return poly->vertices + poly->indices[t * 3 + (k < poly->level ? 0 : j)] * 3;
+}
+
+static float icosahedron_side(const float *p, const float *a, const float *b)
+{
+  return p[0] * (a[1] * b[2] - a[2] * b[1]) +
+    p[1] * (a[2] * b[0] - a[0] * b[2]) +
+    p[2] * (a[0] * b[1] - a[1] * b[0]);
+}
+
+static int icosahedron_locate(const poly_t *poly, const float *normals, const float *p)
+{
+  int t = 0;
+  float best = -INFINITY;
+  for (int f = 0; f < 20 && best < 0; f++) {
+    const float *n = normals + f * 9;
+    float s = fminf(p[0] * n[0] + p[1] * n[1] + p[2] * n[2],
+        fminf(p[0] * n[3] + p[1] * n[4] + p[2] * n[5], p[0] * n[6] + p[1] * n[7] + p[2] * n[8]));
+    if (s > best) {
+      best = s;
+      t = f;
+    }
+  }
+
+  for (int k = 0, T = 20; k < poly->level; k++, T *= 4) {
+    int center = T + 3 * t + 2;
+    const float *m12 = icosahedron_corner(poly, k + 1, center, 0);
+    const float *m23 = icosahedron_corner(poly, k + 1, center, 1);
+    const float *m31 = icosahedron_corner(poly, k + 1, center, 2);
+    if (icosahedron_side(p, m31, m12) < 0) {
+      continue;
+    } else if (icosahedron_side(p, m12, m23) < 0) {
+      t = T + 3 * t;
+    } else if (icosahedron_side(p, m23, m31) < 0) {
+      t = T + 3 * t + 1;
+    } else {
+      t = center;
+    }
+  }
+
+  return t;
+}
+
+bool poly_locate(const poly_t *poly, const float *points, int n, int *triangles)
+{
+  float normals[20 * 9];
+  if (!icosahedron_uniform(poly)) {
+    return false;
+  }
+  for (int f = 0; f < 20; f++) {
+    for (int j = 0; j < 3; j++) {
+      const float *a = icosahedron_corner(poly, 0, f, j);
+      const float *b = icosahedron_corner(poly, 0, f, (j + 1) % 3);
+      float *n = normals + f * 9 + j * 3;
+      n[0] = a[1] * b[2] - a[2] * b[1];
+      n[1] = a[2] * b[0] - a[0] * b[2];
+      n[2] = a[0] * b[1] - a[1] * b[0];
+    }
+  }
+  for (int i = 0; i < n; i++) {
+    triangles[i] = icosahedron_locate(poly, normals, points + i * 3);
+  }
+  return true;
+}
+
+typedef struct {
+  poly_adaptive_t *adaptive;
+  vec4d eye, axis;
+  double distance, horizon;
+  double scale, threshold, min_angle;
+  int depth;
+  bool failed;
+} adaptive_frame_t;
+
+static bool adaptive_reserve(poly_t *poly, int v_len)
+{
+  if (v_len <= poly->v_cap) {
+    return true;
+  }
+  int cap = poly->v_cap / 3 > 0 ? poly->v_cap / 3 : 64;
+  while (cap * 3 < v_len) { cap *= 2; }
+  float *vs = realloc(poly->vertices, cap * 3 * sizeof(float));
+  if (vs == NULL) { return false; }
+  poly->vertices = vs;
+  float *ts = realloc(poly->texcoords, cap * 2 * sizeof(float));
+  if (ts == NULL) { return false; }
+  poly->texcoords = ts;
+  poly->v_cap = cap * 3;
+  poly->t_cap = cap * 2;
+  return true;
+}
+
+static unsigned adaptive_hash(int a, int b, int cap)
+{
+  return ((unsigned)a * 73856093u ^ (unsigned)b * 19349663u) & (cap - 1);
+}
+
+// Moves the edges to a table of cap slots, with evict the ones the last
+// update did not split are dropped and their midpoint slots freed.
+static bool adaptive_edges_rehash(poly_adaptive_t *adaptive, int cap, bool evict)
+{
+  int *edges = malloc(cap * 4 * sizeof(int));
+  if (edges == NULL) {
+    return false;
+  }
+  memset(edges, -1, cap * 4 * sizeof(int));
+  for (int i = 0; i < adaptive->e_cap; i++) {
+    int *e = adaptive->edges + i * 4;
+    if (e[0] < 0) { continue; }
+    if (evict && e[3] != adaptive->update) {
+      adaptive->v_free[adaptive->f_len++] = e[2];
+      adaptive->e_len--;
+      continue;
+    }
+    unsigned h = adaptive_hash(e[0], e[1], cap);
+    while (edges[h * 4] >= 0) { h = (h + 1) & (cap - 1); }
+    memcpy(edges + h * 4, e, 4 * sizeof(int));
+  }
+  free(adaptive->edges);
+  adaptive->edges = edges;
+  adaptive->e_cap = cap;
+  return true;
+}
+
+static bool adaptive_slots_reserve(poly_adaptive_t *adaptive, int len)
+{
+  if (len <= adaptive->s_cap) {
+    return true;
+  }
+  int cap = adaptive->s_cap > 0 ? adaptive->s_cap * 2 : 1024;
+  while (cap < len) { cap *= 2; }
+  int *fs = realloc(adaptive->v_free, cap * sizeof(int));
+  if (fs == NULL) { return false; }
+  adaptive->v_free = fs;
+  int *ds = realloc(adaptive->v_dirty, cap * sizeof(int));
+  if (ds == NULL) { return false; }
+  adaptive->v_dirty = ds;
+  adaptive->s_cap = cap;
+  return true;
+}
+
+static int adaptive_midpoint(adaptive_frame_t *frame, int a, int b)
+{
+  poly_adaptive_t *adaptive = frame->adaptive;
+  poly_t *poly = adaptive->poly;
+  unsigned h = adaptive_hash(a, b, adaptive->e_cap);
+  int *e;
+  for (e = adaptive->edges + h * 4; e[0] >= 0; e = adaptive->edges + h * 4) {
+    if (e[0] == a && e[1] == b) {
+      e[3] = adaptive->update;
+      return e[2];
+    }
+    h = (h + 1) & (adaptive->e_cap - 1);
+  }
+
+  if ((adaptive->e_len + 1) * 2 > adaptive->e_cap) {
+    if (!adaptive_edges_rehash(adaptive, adaptive->e_cap * 2, false)) { return -1; }
+    return adaptive_midpoint(frame, a, b);
+  }
+  int vi = adaptive->f_len > 0 ? adaptive->v_free[adaptive->f_len - 1] : adaptive->v_stable;
+  if (!adaptive_reserve(poly, (adaptive->v_stable + 1) * 3) ||
+      !adaptive_slots_reserve(adaptive, adaptive->v_stable + 1)) {
+    return -1;
+  }
+  if (adaptive->f_len > 0) {
+    adaptive->f_len--;
+  } else {
+    adaptive->v_stable++;
+  }
+  e[0] = a; e[1] = b; e[2] = vi; e[3] = adaptive->update;
+  adaptive->e_len++;
+  adaptive->v_dirty[adaptive->d_len++] = vi;
+
+  float *va = poly->vertices + a * 3, *vb = poly->vertices + b * 3;
+  vec4d v = vec4d_normalize((vec4d)vector_new(va[0] + vb[0], va[1] + vb[1], va[2] + vb[2]));
+  poly->vertices[vi*3] = v.ptr[0];
+  poly->vertices[vi*3+1] = v.ptr[1];
+  poly->vertices[vi*3+2] = v.ptr[2];
+  texcoord_calculate(poly, vi);
+  poly->v_len = adaptive->v_stable * 3;
+  poly->t_len = adaptive->v_stable * 2;
+  return vi;
+}
+
+// The decision only depends on the edge, so both triangles sharing it
+// agree and the mesh stays free of T-junctions whatever gets refined.
+static bool adaptive_split(adaptive_frame_t *frame, int a, int b)
+{
+  const float *va = frame->adaptive->poly->vertices + a * 3, *vb = frame->adaptive->poly->vertices + b * 3;
+  vec4d pa = vector_new(va[0], va[1], va[2]), pb = vector_new(vb[0], vb[1], vb[2]);
+  double d = vec4d_dot_product(pa, pb);
+  double angle = acos(fmin(1, fmax(-1, d)));
+  if (angle <= frame->min_angle) {
+    return false;
+  }
+
+  // edges too far beyond the horizon to belong to a visible triangle
+  if (frame->distance > 1) {
+    double ha = acos(fmin(1, vec4d_dot_product(pa, frame->axis))) - frame->horizon;
+    double hb = acos(fmin(1, vec4d_dot_product(pb, frame->axis))) - frame->horizon;
+    if (fmin(ha, hb) > 4 * angle) {
+      return false;
+    }
+  }
+
+  // sagitta of the chord against the camera distance of the edge
+  double sagitta = 1 - sqrt((1 + d) / 2);
+  vec4d mid = vector_scale(vector_add(pa, pb), 0.5);
+  double chord = vec4d_length(vector_add(pa, vector_scale(pb, -1)));
+  double distance = vec4d_length(vector_add(frame->eye, vector_scale(mid, -1))) - chord / 2;
+  return sagitta * frame->scale > frame->threshold * fmax(distance, 1e-9);
+}
+
+static bool adaptive_emit(poly_adaptive_t *adaptive, int a, int b, int c)
+{
+  poly_t *poly = adaptive->poly;
+  if (poly->i_len + 3 > adaptive->i_cap) {
+    int cap = adaptive->i_cap > 0 ? adaptive->i_cap * 2 : 1024;
+    int *is = realloc(poly->indices, cap * sizeof(int));
+    if (is == NULL) { return false; }
+    poly->indices = is;
+    adaptive->i_cap = cap;
+  }
+  poly->indices[poly->i_len++] = a;
+  poly->indices[poly->i_len++] = b;
+  poly->indices[poly->i_len++] = c;
+  return true;
+}
+
+static void adaptive_refine(adaptive_frame_t *frame, int a, int b, int c, int depth)
+{
+  int v[3] = {a, b, c}, m[3] = {-1, -1, -1}, count = 0;
+  for (int i = 0; i < 3 && depth < frame->depth && !frame->failed; i++) {
+    int e0 = v[i] < v[(i+1)%3] ? v[i] : v[(i+1)%3];
+    int e1 = v[i] < v[(i+1)%3] ? v[(i+1)%3] : v[i];
+    if (adaptive_split(frame, e0, e1)) {
+      m[i] = adaptive_midpoint(frame, e0, e1);
+      frame->failed |= m[i] < 0;
+      count++;
+    }
+  }
+  if (frame->failed) {
+    return;
+  }
+
+  int i = 0;
+  switch (count) {
+    case 0:
+      frame->failed = !adaptive_emit(frame->adaptive, a, b, c);
+      break;
+    case 1:
+      while (m[i] < 0) { i++; }
+      adaptive_refine(frame, v[i], m[i], v[(i+2)%3], depth + 1);
+      adaptive_refine(frame, m[i], v[(i+1)%3], v[(i+2)%3], depth + 1);
+      break;
+    case 2: {
+      while (m[i] >= 0) { i++; }
+      // edge v2 v0 is kept, the quad v0 m01 m12 v2 is cut along its shorter diagonal
+      int v0 = v[(i+1)%3], v1 = v[(i+2)%3], v2 = v[i], m01 = m[(i+1)%3], m12 = m[(i+2)%3];
+      const float *vs = frame->adaptive->poly->vertices;
+      float d1 = 0, d2 = 0;
+      for (int k = 0; k < 3; k++) {
+        d1 += (vs[v0*3+k] - vs[m12*3+k]) * (vs[v0*3+k] - vs[m12*3+k]);
+        d2 += (vs[m01*3+k] - vs[v2*3+k]) * (vs[m01*3+k] - vs[v2*3+k]);
+      }
+      adaptive_refine(frame, m01, v1, m12, depth + 1);
+      if (d1 < d2) {
+        adaptive_refine(frame, v0, m01, m12, depth + 1);
+        adaptive_refine(frame, v0, m12, v2, depth + 1);
+      } else {
+        adaptive_refine(frame, v0, m01, v2, depth + 1);
+        adaptive_refine(frame, m01, m12, v2, depth + 1);
+      }
+      break;
+    }
+    default:
+      adaptive_refine(frame, a, m[0], m[2], depth + 1);
+      adaptive_refine(frame, b, m[1], m[0], depth + 1);
+      adaptive_refine(frame, c, m[2], m[1], depth + 1);
+      adaptive_refine(frame, m[0], m[1], m[2], depth + 1);
+  }
+}
+
+poly_adaptive_t *poly_adaptive_create(enum poly_type type, int max_level)
+{
+  if (type != POLY_ICOSAHEDRON || max_level < 0 || max_level > 20) {
+    return NULL;
+  }
+  poly_adaptive_t *adaptive = calloc(1, sizeof(poly_adaptive_t));
+  if (adaptive == NULL) {
+    return NULL;
+  }
+  adaptive->max_level = max_level;
+  adaptive->e_cap = 1024;
+  adaptive->edges = malloc(adaptive->e_cap * 4 * sizeof(int));
+  adaptive->poly = calloc(1, sizeof(poly_t));
+  if (adaptive->edges == NULL || adaptive->poly == NULL ||
+      !adaptive_reserve(adaptive->poly, sizeof(icosahedron_vertices) / sizeof(float))) {
+    poly_adaptive_destroy(adaptive);
+    return NULL;
+  }
+  memset(adaptive->edges, -1, adaptive->e_cap * 4 * sizeof(int));
+
+  poly_t *poly = adaptive->poly;
+  const float radius = vec4d_length((vec4d)vector_new(1, M_PHI));
+  poly->type = type;
+  poly->level = -1;
+  poly->v_len = sizeof(icosahedron_vertices) / sizeof(float);
+  poly->t_len = poly->v_len / 3 * 2;
+  for (int i = 0; i < poly->v_len; i++) {
+    poly->vertices[i] = icosahedron_vertices[i] / radius;
+  }
+  for (int i = 0; i < poly->v_len / 3; i++) {
+    texcoord_calculate(poly, i);
+  }
+  adaptive->v_stable = poly->v_len / 3;
+
+  return adaptive;
+}
+
+bool poly_adaptive_update(poly_adaptive_t *adaptive, mat4d view_projection, int height, double threshold)
+{
+  poly_t *poly = adaptive->poly;
+  adaptive_frame_t frame = { .adaptive = adaptive };
+  vec4d row = mat4d_row(view_projection, 1);
+  row.ptr[3] = 0;
+  frame.eye = mat4d_projection_center(view_projection);
+  frame.eye.ptr[3] = 0;
+  frame.distance = vec4d_length(frame.eye);
+  frame.axis = vec4d_normalize(frame.eye);
+  frame.horizon = frame.distance > 1 ? acos(1 / frame.distance) : M_PI;
+  frame.scale = vec4d_length(row) * height / 2;
+  frame.threshold = threshold;
+  // halfway between the edge angles of the last two levels
+  frame.min_angle = acos(1 / sqrt(5)) / (1 << adaptive->max_level) * M_SQRT2;
+  frame.depth = adaptive->max_level * 3 + 8;
+
+  adaptive->update++;
+  adaptive->d_len = 0;
+  poly->v_len = adaptive->v_stable * 3;
+  poly->t_len = adaptive->v_stable * 2;
+  poly->i_len = 0;
+  for (int i = 0; i < 60 && !frame.failed; i += 3) {
+    adaptive_refine(&frame, icosahedron_indices[i], icosahedron_indices[i+1], icosahedron_indices[i+2], 0);
+  }
+  if (frame.failed) {
+    return false;
+  }
+
+  // the table shrinks with the mesh, down to where it started
+  int live = 0, cap = adaptive->e_cap;
+  for (int i = 0; i < adaptive->e_cap; i++) {
+    live += adaptive->edges[i * 4] >= 0 && adaptive->edges[i * 4 + 3] == adaptive->update;
+  }
+  while (cap > 1024 && live * 8 < cap) { cap /= 2; }
+  if (!adaptive_edges_rehash(adaptive, cap, true)) {
+    return false;
+  }
+  return texcoords_seam_fix(poly, NULL);
+}
+
+void poly_adaptive_destroy(poly_adaptive_t *adaptive)
+{
+  if (adaptive->poly != NULL) {
+    poly_destroy(adaptive->poly);
+  }
+  free(adaptive->edges);
+  free(adaptive->v_free);
+  free(adaptive->v_dirty);
+  free(adaptive);
+}
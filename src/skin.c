@@ -0,0 +1,145 @@
+/**
+ * 3dm - simple 3D mathematic library
+ *
+ * Copyright (C) 2013 Cedric Fung <cedric@vec.io>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *    3. Neither the name of the Cedric Fung nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+
+ * THIS SOFTWARE IS PROVIDED BY Cedric Fung "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Cedric Fung BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <math.h>
+#include "3dm/skin.h"
+#include "parallel.h"
+
+typedef vector(float, 4) skin_v4f;
+
+typedef struct {
+  const poly_skin_t *skin;
+  const aff34f *palette;
+  const float *vertices, *normals;
+  float *out_vertices, *out_normals;
+} skin_job_t;
+
+poly_skin_t *poly_skin_create(const poly_t *poly)
+{
+  poly_skin_t *skin = calloc(1, sizeof(poly_skin_t));
+  if (skin == NULL) {
+    return NULL;
+  }
+  skin->len = poly->v_len / 3;
+  skin->max_bone = -1;
+  skin->bones = calloc(skin->len * SKIN_INFLUENCES, sizeof(unsigned short));
+  skin->weights = calloc(skin->len * SKIN_INFLUENCES, sizeof(float));
+  if (skin->bones == NULL || skin->weights == NULL) {
+    poly_skin_destroy(skin);
+    return NULL;
+  }
+  return skin;
+}
+
+void poly_skin_destroy(poly_skin_t *skin)
+{
+  free(skin->bones);
+  free(skin->weights);
+  free(skin);
+}
+
+bool poly_skin_set(poly_skin_t *skin, int vertex, const int bones[SKIN_INFLUENCES], const float weights[SKIN_INFLUENCES])
+{
+  if (vertex < 0 || vertex >= skin->len) {
+    return false;
+  }
+  for (int k = 0; k < SKIN_INFLUENCES; k++) {
+    if (bones[k] < 0 || bones[k] > 0xffff) {
+      return false;
+    }
+  }
+  for (int k = 0; k < SKIN_INFLUENCES; k++) {
+    // unused influences point at bone 0 so they never read out of the palette
+    skin->bones[vertex * SKIN_INFLUENCES + k] = weights[k] != 0 ? bones[k] : 0;
+    skin->weights[vertex * SKIN_INFLUENCES + k] = weights[k];
+    if (weights[k] != 0 && bones[k] > skin->max_bone) {
+      skin->max_bone = bones[k];
+    }
+  }
+  return true;
+}
+
+static inline float skin_dot(skin_v4f a, skin_v4f b)
+{
+  skin_v4f p = a * b;
+  return p[0] + p[1] + p[2] + p[3];
+}
+
+static void skin_run(void *arg, int begin, int end)
+{
+  const skin_job_t *job = arg;
+  const unsigned short *bones = job->skin->bones;
+  const float *weights = job->skin->weights;
+  const aff34f *palette = job->palette;
+
+  for (int i = begin; i < end; i++) {
+    const unsigned short *b = bones + i * SKIN_INFLUENCES;
+    const float *w = weights + i * SKIN_INFLUENCES;
+    // the blended rows, unused influences add nothing
+    skin_v4f r0 = palette[b[0]].row[0].vex * w[0], r1 = palette[b[0]].row[1].vex * w[0], r2 = palette[b[0]].row[2].vex * w[0];
+    for (int k = 1; k < SKIN_INFLUENCES; k++) {
+      if (w[k] != 0) {
+        const aff34f *m = palette + b[k];
+        r0 += m->row[0].vex * w[k];
+        r1 += m->row[1].vex * w[k];
+        r2 += m->row[2].vex * w[k];
+      }
+    }
+
+    const float *v = job->vertices + i * 3;
+    skin_v4f p = {v[0], v[1], v[2], 1};
+    float *o = job->out_vertices + i * 3;
+    o[0] = skin_dot(r0, p); o[1] = skin_dot(r1, p); o[2] = skin_dot(r2, p);
+
+    if (job->normals != NULL) {
+      const float *n = job->normals + i * 3;
+      skin_v4f d = {n[0], n[1], n[2], 0};
+      skin_v4f t = {skin_dot(r0, d), skin_dot(r1, d), skin_dot(r2, d), 0};
+      float l = skin_dot(t, t);
+      t *= l > 0 ? 1 / sqrtf(l) : 0;
+      o = job->out_normals + i * 3;
+      o[0] = t[0]; o[1] = t[1]; o[2] = t[2];
+    }
+  }
+}
+
+bool poly_skin_apply(const poly_skin_t *skin, const aff34f *palette, int p_len,
+                     const float *vertices, const float *normals,
+                     float *out_vertices, float *out_normals, int threads)
+{
+  if (p_len < 1 || skin->max_bone >= p_len || (normals != NULL && out_normals == NULL)) {
+    return false;
+  }
+  skin_job_t job = { skin, palette, vertices, normals, out_vertices, out_normals };
+  parallel_for(skin_run, &job, skin->len, threads);
+  return true;
+}
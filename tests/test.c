@@ -1,11 +1,21 @@
 #define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <time.h>
 #include <assert.h>
+#include <pthread.h>
+#include <unistd.h>
 #include "3dm/3dm.h"
 #include "3dm/poly.h"
+#include "3dm/bvh.h"
+#include "3dm/array.h"
+#include "3dm/cache.h"
+#include "3dm/skin.h"
+#include "3dm/occlusion.h"
+#include "3dm/corner.h"
+#include "3dm/meshlet.h"
 
 #define assert_vec4d_equal(u, v) do { \
   if (!vec4d_equal(u, v)) { \
@@ -25,6 +35,17 @@
   } \
 } while (0)
 
+#define assert_mat4d_near(m, n, e) do { \
+  for (int i = 0; i < 16; i++) { \
+    if (fabs((m).ptr[i] - (n).ptr[i]) > (e)) { \
+      fprintf(stderr, "assert_mat4d_near: %d\n", __LINE__); \
+      vector_print(m, 16); \
+      vector_print(n, 16); \
+      abort(); \
+    } \
+  } \
+} while (0)
+
 #define test_begin(name) \
   struct timespec ts; do { \
     clock_gettime(CLOCK_REALTIME, &ts); \
@@ -243,6 +264,11 @@ void test_mat4()
   assert_vec4d_equal(mat4d_multiply_vec4d(m, u), mu_multiply);
   assert_vec4d_equal(mat4d_multiply_vec4d(m, v), mv_multiply);
 
+  assert_mat4d_equal(mat4d_inverse(I), I);
+  assert_mat4d_equal(mat4d_inverse(n), (mat4d)vector_new(0));
+  assert_mat4d_near(mat4d_multiply(mat4d_inverse(r_look_at), r_look_at), I, 1e-12);
+  assert_mat4d_near(mat4d_multiply(r_frustum, mat4d_inverse(r_frustum)), I, 1e-12);
+
   assert_mat4d_equal(mat4d_scale(I, 1, 2, 3), I123_scale);
   assert_mat4d_equal(mat4d_scale(m, 1, 2, 3), mat4d_multiply(I123_scale, m));
   assert_mat4d_equal(mat4d_scale(n, 1, 2, 3), mat4d_multiply(I123_scale, n));
@@ -279,8 +305,10 @@ void test_poly_icosahedron()
 void test_poly_cube()
 {
   test_begin("test_poly_cube");
+  assert(poly_create(POLY_CUBE, 30) == NULL);
   poly_t *poly = poly_create(POLY_CUBE, 0);
   assert(poly != NULL);
+  assert(!poly_subdivide(poly, 40) && poly->level == 0);
   poly_destroy(poly);
   poly = poly_create(POLY_CUBE, 7);
   assert(poly != NULL);
@@ -288,6 +316,1142 @@ void test_poly_cube()
   test_end("test_poly_cube");
 }
 
+void test_poly_cubesphere()
+{
+  test_begin("test_poly_cubesphere");
+  poly_t *poly = poly_create(POLY_CUBESPHERE, 64*64);
+  assert(poly == NULL);
+  assert(poly_create(POLY_CUBESPHERE, 13) == NULL);
+  poly = poly_create(POLY_CUBESPHERE, 0);
+  assert(poly != NULL);
+  assert(poly->v_len == 6 * 4 * 3);
+  assert(poly->i_len == 6 * 6);
+  poly_destroy(poly);
+  poly = poly_create(POLY_CUBESPHERE, 7);
+  assert(poly != NULL);
+  assert(poly->v_len / 3 == poly->t_len / 2);
+  for (int i = 0; i < poly->v_len; i += 3) {
+    float *p = poly->vertices + i;
+    assert(fabsf(p[0] * p[0] + p[1] * p[1] + p[2] * p[2] - 1) < 1e-5);
+  }
+  for (int i = 0; i < poly->i_len; i += 3) {
+    float *t1 = poly->texcoords + poly->indices[i] * 2;
+    float *t2 = poly->texcoords + poly->indices[i+1] * 2;
+    float *t3 = poly->texcoords + poly->indices[i+2] * 2;
+    assert(fabsf(t1[0] - t2[0]) < 0.01 && fabsf(t1[0] - t3[0]) < 0.01);
+    assert(fabsf(t1[1] - t2[1]) < 0.01 && fabsf(t1[1] - t3[1]) < 0.01);
+  }
+  poly_destroy(poly);
+
+  // the faces meet exactly, so welding closes the sphere
+  for (int n = 0; n <= 7; n++) {
+    poly = poly_create(POLY_CUBESPHERE, n);
+    corner_table_t *ct = corner_table_create(poly);
+    assert(ct != NULL);
+    int borders = 0;
+    for (int c = 0; c < ct->c_len; c++) {
+      borders += ct->opposites[c] < 0;
+    }
+    assert(borders == 0);
+    assert(ct->v_len - ct->c_len / 2 + ct->c_len / 3 == 2);
+    corner_table_destroy(ct);
+    poly_destroy(poly);
+  }
+  test_end("test_poly_cubesphere");
+}
+
+static int ray_intersect_brute(poly_t *poly, ray_t ray, float *t)
+{
+  int id = -1;
+  *t = INFINITY;
+  for (int i = 0; i < poly->i_len; i += 3) {
+    float *v0 = poly->vertices + poly->indices[i] * 3;
+    float *v1 = poly->vertices + poly->indices[i+1] * 3;
+    float *v2 = poly->vertices + poly->indices[i+2] * 3;
+    vec4d o = vector_new(ray.origin.ptr[0], ray.origin.ptr[1], ray.origin.ptr[2]);
+    vec4d d = vector_new(ray.direction.ptr[0], ray.direction.ptr[1], ray.direction.ptr[2]);
+    vec4d a = vector_new(v0[0], v0[1], v0[2]);
+    vec4d e1 = vector_new(v1[0] - v0[0], v1[1] - v0[1], v1[2] - v0[2]);
+    vec4d e2 = vector_new(v2[0] - v0[0], v2[1] - v0[1], v2[2] - v0[2]);
+    vec4d p = vec4d_cross_product(d, e2);
+    double det = vec4d_dot_product(e1, p);
+    if (det == 0) { continue; }
+    vec4d s = vector_add(o, vector_scale(a, -1));
+    vec4d q = vec4d_cross_product(s, e1);
+    double u = vec4d_dot_product(s, p) / det, v = vec4d_dot_product(d, q) / det;
+    double tt = vec4d_dot_product(e2, q) / det;
+    if (u >= 0 && v >= 0 && u + v <= 1 && tt > 0 && tt < *t) {
+      *t = tt;
+      id = i / 3;
+    }
+  }
+  return id;
+}
+
+void test_bvh()
+{
+  test_begin("test_bvh");
+  const int w = 512, h = 512;
+  poly_t *poly = poly_create(POLY_ICOSAHEDRON, 5);
+  bvh_t *bvh = bvh_create(poly);
+  assert(bvh != NULL);
+  assert(bvh->t_len == poly->i_len / 3);
+
+  {
+    poly_t empty = { .type = POLY_ICOSAHEDRON };
+    bvh_t *none = bvh_create(&empty);
+    ray_t ray = { vector_new(0, 0, 2), vector_new(0, 0, -1) };
+    ray_hit_t hit;
+    assert(none != NULL && none->n_len == 0 && none->t_len == 0);
+    assert(!bvh_intersect(none, ray, &hit) && hit.triangle == -1);
+    assert(bvh_intersect_rays(none, (ray_t[5]){ray, ray, ray, ray, ray}, (ray_hit_t[5]){0}, 5) == 0);
+    bvh_destroy(none);
+  }
+
+  mat4d vp = mat4d_multiply(mat4d_perspective(60, 1, 0.1, 100),
+      mat4d_look_at((vec4d)vector_new(0.3, 0.4, 2.5), (vec4d)vector_new(0), (vec4d)vector_new(0, 1)));
+  mat4d inverse = mat4d_inverse(vp);
+  ray_t *rays = malloc(w * h * sizeof(ray_t));
+  ray_hit_t *hits = malloc(w * h * sizeof(ray_hit_t));
+  for (int y = 0; y < h; y++) {
+    for (int x = 0; x < w; x++) {
+      rays[y * w + x] = ray_unproject(inverse, x + 0.5, y + 0.5, w, h);
+    }
+  }
+
+  ray_t center = ray_unproject(inverse, w / 2.0, h / 2.0, w, h);
+  ray_hit_t hit;
+  assert(bvh_intersect(bvh, center, &hit));
+  assert(fabsf(hit.t - (sqrtf(0.3f * 0.3f + 0.4f * 0.4f + 2.5f * 2.5f) - 0.1f - 1)) < 0.01f);
+  ray_t away = { vector_new(0, 0, 2), vector_new(0, 0, 1) };
+  assert(!bvh_intersect(bvh, away, &hit));
+  assert(hit.triangle == -1);
+
+  struct timespec t0, t1;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  int count = bvh_intersect_rays(bvh, rays, hits, w * h);
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  double s = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+  printf("BENCH: bvh %d triangles, %d nodes, %d rays, %d hits, %.2f Mrays/s\n",
+      bvh->t_len, bvh->n_len, w * h, count, w * h / s / 1e6);
+  assert(count > 0 && count < w * h);
+
+  for (int i = 0; i < w * h; i += 997) {
+    float t;
+    int id = ray_intersect_brute(poly, rays[i], &t);
+    assert((id < 0) == (hits[i].triangle < 0));
+    if (id >= 0) {
+      assert(fabsf(t - hits[i].t) < 1e-4);
+    }
+  }
+
+  free(rays);
+  free(hits);
+  bvh_destroy(bvh);
+  poly_destroy(poly);
+  test_end("test_bvh");
+}
+
+void test_poly_locate()
+{
+  test_begin("test_poly_locate");
+  const int count = 10000000;
+  poly_t *poly = poly_create(POLY_CUBE, 2);
+  assert(!poly_locate(poly, (float[]){0, 0, 1}, 1, (int[1]){0}));
+  poly_destroy(poly);
+
+  float *points = malloc(count * 3 * sizeof(float));
+  int *triangles = malloc(count * sizeof(int));
+  unsigned int seed = 1;
+  for (int i = 0; i < count * 3; i++) {
+    seed = seed * 1103515245 + 12345;
+    points[i] = (seed >> 8) / (float)(1 << 24) * 2 - 1;
+  }
+
+  for (int level = 0; level <= 7; level += 7) {
+    poly = poly_create(POLY_ICOSAHEDRON, level);
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    assert(poly_locate(poly, points, count, triangles));
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double s = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    printf("BENCH: poly_locate level %d, %d points, %.2f Mpoints/s\n", level, count, count / s / 1e6);
+
+    for (int i = 0; i < count; i += 101) {
+      float *p = points + i * 3;
+      int t = triangles[i];
+      assert(t >= 0 && t < poly->i_len / 3);
+      float *v[3];
+      for (int j = 0; j < 3; j++) { v[j] = poly->vertices + poly->indices[t * 3 + j] * 3; }
+      for (int j = 0; j < 3; j++) {
+        float *a = v[j], *b = v[(j + 1) % 3];
+        vec4d c = vec4d_cross_product((vec4d)vector_new(a[0], a[1], a[2]), (vec4d)vector_new(b[0], b[1], b[2]));
+        vec4d q = vector_new(p[0], p[1], p[2]);
+        assert(vec4d_dot_product(c, q) / vec4d_length(q) > -1e-6);
+      }
+    }
+    poly_destroy(poly);
+  }
+
+  free(points);
+  free(triangles);
+  test_end("test_poly_locate");
+}
+
+void test_array()
+{
+  test_begin("test_array");
+  const int count = 100003;
+  mat4d_array *a = mat4d_array_create(count), *b = mat4d_array_create(count), *r = mat4d_array_create(count);
+  mat4f_array *af = mat4f_array_create(count), *rf = mat4f_array_create(count);
+  mat4d *models = aligned_alloc(sizeof(mat4d), count * sizeof(mat4d));
+  mat4d *results = aligned_alloc(sizeof(mat4d), count * sizeof(mat4d));
+  mat4d vp = mat4d_multiply(mat4d_perspective(60, 1.5, 0.1, 100),
+      mat4d_look_at((vec4d)vector_new(1, 2, 3), (vec4d)vector_new(0), (vec4d)vector_new(0, 1)));
+  for (int i = 0; i < count; i++) {
+    models[i] = mat4d_translate(mat4d_rotate(I, (vec4d)vector_new(0, 1, 1), i), i, -i, 1);
+    mat4d_array_set(a, i, models[i]);
+    mat4d_array_set(b, i, m);
+    mat4f_array_set(af, i, mat4d_to_mat4f(models[i]));
+  }
+  assert_mat4d_equal(mat4d_array_get(a, count - 1), models[count - 1]);
+
+  struct timespec t0, t1, t2, t3;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (int i = 0; i < count; i++) {
+    results[i] = mat4d_multiply(vp, models[i]);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  assert(mat4d_array_multiply_mat4d(r, vp, a, 1));
+  clock_gettime(CLOCK_MONOTONIC, &t2);
+  assert(mat4f_array_multiply_mat4f(rf, mat4d_to_mat4f(vp), af, 1));
+  clock_gettime(CLOCK_MONOTONIC, &t3);
+  double s0 = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+  double s1 = (t2.tv_sec - t1.tv_sec) + (t2.tv_nsec - t1.tv_nsec) / 1e9;
+  double s2 = (t3.tv_sec - t2.tv_sec) + (t3.tv_nsec - t2.tv_nsec) / 1e9;
+  printf("BENCH: mat4d_multiply %.2f M/s, mat4d_array %.2f M/s, mat4f_array %.2f M/s\n",
+      count / s0 / 1e6, count / s1 / 1e6, count / s2 / 1e6);
+
+  for (int i = 0; i < count; i += 7) {
+    assert_mat4d_near(mat4d_array_get(r, i), results[i], 1e-9 * (1 + i));
+    mat4f f = mat4f_array_get(rf, i);
+    for (int e = 0; e < 16; e++) {
+      assert(fabs(f.ptr[e] - results[i].ptr[e]) <= 1e-5 * (1 + fabs(results[i].ptr[e])));
+    }
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  assert(mat4d_array_multiply_mat4d(a, vp, a, 4));
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  s0 = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+  printf("BENCH: mat4d_array 4 threads %.2f M/s\n", count / s0 / 1e6);
+  for (int i = 0; i < count; i += 7) {
+    assert_mat4d_equal(mat4d_array_get(a, i), mat4d_array_get(r, i));
+  }
+  assert(mat4d_array_multiply(r, a, b, 3));
+  for (int i = 0; i < count; i += 7) {
+    assert_mat4d_near(mat4d_array_get(r, i), mat4d_multiply(results[i], m), 1e-9 * (1 + i));
+  }
+
+  mat4d_array *short_r = mat4d_array_create(count - 1);
+  assert(!mat4d_array_multiply_mat4d(short_r, vp, a, 1));
+  assert(!mat4d_array_multiply(short_r, a, b, 1));
+  assert(!mat4d_array_multiply(r, a, short_r, 1));
+  mat4d_array_destroy(short_r);
+
+  free(models);
+  free(results);
+  mat4d_array_destroy(a);
+  mat4d_array_destroy(b);
+  mat4d_array_destroy(r);
+  mat4f_array_destroy(af);
+  mat4f_array_destroy(rf);
+  test_end("test_array");
+}
+
+static long double ulp_error(double x, long double ref)
+{
+  if (ref == 0) {
+    return x == 0 ? 0 : INFINITY;
+  }
+  return fabsl(x - ref) / ldexpl(1, ilogbl(ref) - 52);
+}
+
+static inline double ulp_sample(double lo, double hi, bool log_scale, double f)
+{
+  return log_scale ? exp(log(lo) + (log(hi) - log(lo)) * f) : lo + (hi - lo) * f;
+}
+
+// samples [lo, hi] evenly, or evenly in log scale with a positive lo
+static double ulp_report(const char *name, enum precision p, double lo, double hi, bool log_scale,
+    double (*f)(double, enum precision), long double (*ref)(long double))
+{
+  const int count = 1000000;
+  const char *tiers[] = {"exact", "fast", "fastest"};
+  long double max = 0, sum = 0;
+  double *xs = malloc(count * sizeof(double)), ns[2];
+  for (int i = 0; i < count; i++) {
+    xs[i] = ulp_sample(lo, hi, log_scale, (i + 0.5) / count);
+  }
+  // the same samples through the exact tier for the speedup, best of
+  // three interleaved runs as a single one is noisy
+  ns[0] = ns[1] = INFINITY;
+  for (int r = 0; r < 6; r++) {
+    struct timespec t0, t1;
+    volatile double sink = 0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < count; i++) {
+      sink += f(xs[i], r % 2 == 0 ? p : PRECISION_EXACT);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns[r % 2] = fmin(ns[r % 2], ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / count);
+  }
+  for (int i = 0; i < count; i++) {
+    long double e = ulp_error(f(xs[i], p), ref(xs[i]));
+    sum += e;
+    max = e > max ? e : max;
+  }
+  free(xs);
+  printf("ULP: %-6s %-8s [%.0e, %.0e] max %12.1Lf mean %10.2Lf  %.2fx exact\n",
+         name, tiers[p], lo, hi, max, sum / count, ns[1] / ns[0]);
+  return max;
+}
+
+void test_precision()
+{
+  test_begin("test_precision");
+  const double bounds[] = {2, 512, 1 << 25};
+  for (enum precision p = PRECISION_EXACT; p <= PRECISION_FASTEST; p++) {
+    assert(ulp_report("sin", p, -2 * M_PI, 2 * M_PI, false, approx_sin, sinl) <= bounds[p]);
+    assert(ulp_report("cos", p, -2 * M_PI, 2 * M_PI, false, approx_cos, cosl) <= bounds[p]);
+    assert(ulp_report("sin", p, -APPROX_SINCOS_MAX, APPROX_SINCOS_MAX, false, approx_sin, sinl) <= bounds[p]);
+    assert(ulp_report("cos", p, 1, APPROX_SINCOS_MAX, true, approx_cos, cosl) <= bounds[p]);
+    assert(ulp_report("sin", p, APPROX_SINCOS_MAX / 2, 1e15, true, approx_sin, sinl) <= bounds[p]);
+    assert(ulp_report("tan", p, -1.5, 1.5, false, approx_tan, tanl) <= bounds[p]);
+  }
+
+  precision_set(PRECISION_FASTEST);
+  assert(precision_get() == PRECISION_FASTEST);
+  mat4f r = mat4d_to_mat4f(mat4d_rotate(I, (vec4d)vector_new(0, 0, 1), 10));
+  mat4f f = mat4d_to_mat4f(mat4d_perspective(60, 1.5, 0.1, 100));
+  precision_set(PRECISION_EXACT);
+  assert_mat4d_near(mat4d_rotate(I, (vec4d)vector_new(0, 0, 1), 10), I001_10_rotate, 0);
+  for (int i = 0; i < 16; i++) {
+    assert(fabs(r.ptr[i] - I001_10_rotate.ptr[i]) < 1e-7);
+    assert(fabs(f.ptr[i] - mat4d_perspective(60, 1.5, 0.1, 100).ptr[i]) < 1e-6);
+  }
+  test_end("test_precision");
+}
+
+void test_affine()
+{
+  test_begin("test_affine");
+  assert(sizeof(aff34d) == sizeof(mat4d) * 3 / 4);
+  assert(sizeof(aff34f) == sizeof(mat4f) * 3 / 4);
+  mat4d a = mat4d_translate(mat4d_rotate(mat4d_scale(I, 1, 2, 3), (vec4d)vector_new(1, 1, 0), 30), 1, 2, 3);
+  mat4d b = r_look_at;
+  aff34d aa = aff34d_from_mat4d(a), ab = aff34d_from_mat4d(b);
+  assert_mat4d_equal(aff34d_to_mat4d(aff34d_identity()), I);
+  assert_mat4d_equal(aff34d_to_mat4d(aa), a);
+  assert_mat4d_near(aff34d_to_mat4d(aff34d_multiply(aa, ab)), mat4d_multiply(a, b), 1e-12);
+  assert_mat4d_near(aff34d_to_mat4d(aff34d_multiply(aff34d_inverse(aa), aa)), I, 1e-12);
+  assert_mat4d_near(aff34d_to_mat4d(aff34d_inverse(ab)), mat4d_inverse(b), 1e-12);
+  assert_mat4d_near(aff34d_to_mat4d(aff34d_translate(aff34d_rotate(aff34d_scale(aff34d_identity(), 1, 2, 3),
+      (vec4d)vector_new(1, 1, 0), 30), 1, 2, 3)), a, 1e-12);
+  assert_mat4d_equal(aff34d_to_mat4d(aff34d_inverse(aff34d_from_mat4d(n))), aff34d_to_mat4d((aff34d){{0}}));
+
+  vec4d p = aff34d_transform_point(aa, u);
+  vec4d q = mat4d_multiply_vec4d(a, (vec4d)vector_new(1, 2, 3, 1));
+  vec4d d = aff34d_transform_direction(aa, u);
+  vec4d e = mat4d_multiply_vec4d(a, (vec4d)vector_new(1, 2, 3, 0));
+  for (int i = 0; i < 4; i++) {
+    assert(fabs(p.ptr[i] - q.ptr[i]) < 1e-12);
+    assert(fabs(d.ptr[i] - e.ptr[i]) < 1e-12);
+  }
+
+  aff34f fa = aff34d_to_aff34f(aa), fb = aff34d_to_aff34f(ab);
+  mat4f fab = aff34f_to_mat4f(aff34f_multiply(fa, fb));
+  mat4d ab_d = mat4d_multiply(a, b);
+  vec4f fp = aff34f_transform_point(fa, (vec4f)vector_new(1, 2, 3, 4));
+  vec4f fd = aff34f_transform_direction(fa, (vec4f)vector_new(1, 2, 3, 4));
+  for (int i = 0; i < 16; i++) {
+    assert(fabs(fab.ptr[i] - ab_d.ptr[i]) < 1e-5);
+  }
+  for (int i = 0; i < 4; i++) {
+    assert(fabs(fp.ptr[i] - q.ptr[i]) < 1e-5);
+    assert(fabs(fd.ptr[i] - e.ptr[i]) < 1e-5);
+  }
+  test_end("test_affine");
+}
+
+static const float *sort_vertices;
+
+static int vertex_compare(const void *a, const void *b)
+{
+  return memcmp(sort_vertices + *(const int *)a * 3, sort_vertices + *(const int *)b * 3, 3 * sizeof(float));
+}
+
+static int edge_compare(const void *a, const void *b)
+{
+  const long *x = a, *y = b;
+  return *x < *y ? -1 : *x > *y;
+}
+
+// every edge between vertices at the same positions is used exactly once in
+// each direction, so there is no hole nor T-junction in the mesh
+static bool poly_watertight(const poly_t *poly)
+{
+  int vn = poly->v_len / 3, en = poly->i_len;
+  int *order = malloc(vn * sizeof(int)), *weld = malloc(vn * sizeof(int));
+  long *edges = malloc(en * sizeof(long)), *reverse = malloc(en * sizeof(long));
+  for (int i = 0; i < vn; i++) { order[i] = i; }
+  sort_vertices = poly->vertices;
+  qsort(order, vn, sizeof(int), vertex_compare);
+  for (int i = 0, w = -1; i < vn; i++) {
+    if (i == 0 || vertex_compare(&order[i-1], &order[i]) != 0) { w++; }
+    weld[order[i]] = w;
+  }
+  for (int i = 0; i < en; i++) {
+    long a = weld[poly->indices[i]], b = weld[poly->indices[i % 3 == 2 ? i - 2 : i + 1]];
+    edges[i] = a * vn + b;
+    reverse[i] = b * vn + a;
+  }
+  qsort(edges, en, sizeof(long), edge_compare);
+  qsort(reverse, en, sizeof(long), edge_compare);
+  bool watertight = true;
+  for (int i = 0; i < en && watertight; i++) {
+    watertight = edges[i] == reverse[i] && (i == 0 || edges[i] != edges[i-1]);
+  }
+  free(order);
+  free(weld);
+  free(edges);
+  free(reverse);
+  return watertight;
+}
+
+void test_poly_adaptive()
+{
+  test_begin("test_poly_adaptive");
+  assert(poly_adaptive_create(POLY_CUBE, 3) == NULL);
+  poly_adaptive_t *adaptive = poly_adaptive_create(POLY_ICOSAHEDRON, 9);
+  poly_t *uniform = poly_create(POLY_ICOSAHEDRON, 4);
+  assert(poly_watertight(uniform));
+  poly_destroy(uniform);
+
+  vec4d eye = vector_new(0, 0.2, 1.3);
+  mat4d vp = mat4d_multiply(mat4d_perspective(60, 16.0 / 9, 0.01, 100),
+      mat4d_look_at(eye, (vec4d)vector_new(0), (vec4d)vector_new(0, 1)));
+  vec4d center = mat4d_projection_center(vp);
+  for (int i = 0; i < 3; i++) {
+    assert(fabs(center.ptr[i] - eye.ptr[i]) < 1e-9);
+  }
+
+  struct timespec t0, t1;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  assert(poly_adaptive_update(adaptive, vp, 720, 0.1));
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  poly_t *poly = adaptive->poly;
+  long us = (t1.tv_sec - t0.tv_sec) * 1000000 + (t1.tv_nsec - t0.tv_nsec) / 1000;
+  printf("BENCH: adaptive %d triangles, %d vertices (uniform level 9: %d triangles), %ld us\n",
+      poly->i_len / 3, poly->v_len / 3, 20 << 18, us);
+  assert(poly->i_len / 3 < (20 << 18) / 10);
+  assert(poly->v_len / 3 == poly->t_len / 2);
+  assert(poly_watertight(poly));
+  // not a uniform level, so nothing that relies on the layout of one
+  assert(poly->level == -1);
+  assert(!poly_locate(poly, (float[]){0, 0, 1}, 1, (int[1]){0}));
+  assert(!poly_subdivide(poly, 1));
+  for (int i = 0; i < poly->i_len; i += 3) {
+    float *t1 = poly->texcoords + poly->indices[i] * 2, *t2 = poly->texcoords + poly->indices[i+1] * 2;
+    assert(fabsf(t1[0] - t2[0]) < 0.64);
+  }
+
+  int stable = adaptive->v_stable;
+  float *prefix = malloc(stable * 3 * sizeof(float));
+  memcpy(prefix, poly->vertices, stable * 3 * sizeof(float));
+  vp = mat4d_multiply(mat4d_perspective(60, 16.0 / 9, 0.01, 100),
+      mat4d_look_at((vec4d)vector_new(0.5, 0.2, 1.2), (vec4d)vector_new(0), (vec4d)vector_new(0, 1)));
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  assert(poly_adaptive_update(adaptive, vp, 720, 0.1));
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  us = (t1.tv_sec - t0.tv_sec) * 1000000 + (t1.tv_nsec - t0.tv_nsec) / 1000;
+  printf("BENCH: adaptive update %d triangles, %d vertices written, %ld us\n",
+      poly->i_len / 3, adaptive->d_len, us);
+  // only the slots written by the update changed
+  bool *dirty = calloc(adaptive->v_stable, sizeof(bool));
+  for (int i = 0; i < adaptive->d_len; i++) {
+    dirty[adaptive->v_dirty[i]] = true;
+  }
+  for (int i = 0; i < stable; i++) {
+    assert(dirty[i] || memcmp(prefix + i * 3, poly->vertices + i * 3, 3 * sizeof(float)) == 0);
+  }
+  free(dirty);
+  assert(poly_watertight(poly));
+
+  // orbiting the camera keeps the cache to about what one view needs
+  int peak = 0;
+  for (int i = 0; i < 16; i++) {
+    double a = i * M_PI / 8;
+    vp = mat4d_multiply(mat4d_perspective(60, 16.0 / 9, 0.01, 100),
+        mat4d_look_at((vec4d)vector_new(1.3 * sin(a), 0.2, 1.3 * cos(a)), (vec4d)vector_new(0), (vec4d)vector_new(0, 1)));
+    assert(poly_adaptive_update(adaptive, vp, 720, 0.1));
+    assert(poly_watertight(poly));
+    peak = adaptive->e_len > peak ? adaptive->e_len : peak;
+  }
+  assert(adaptive->v_stable - 12 < 3 * peak);
+
+  vp = mat4d_multiply(mat4d_perspective(60, 16.0 / 9, 0.01, 1e5),
+      mat4d_look_at((vec4d)vector_new(0, 0, 1e4), (vec4d)vector_new(0), (vec4d)vector_new(0, 1)));
+  assert(poly_adaptive_update(adaptive, vp, 720, 1));
+  assert(poly->i_len == 60);
+  assert(adaptive->e_len == 0 && adaptive->f_len == adaptive->v_stable - 12 && adaptive->e_cap == 1024);
+  free(prefix);
+  poly_adaptive_destroy(adaptive);
+  test_end("test_poly_adaptive");
+}
+
+static long file_size(const char *path)
+{
+  FILE *f = fopen(path, "rb");
+  assert(f != NULL);
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  fclose(f);
+  return size;
+}
+
+void test_poly_export()
+{
+  test_begin("test_poly_export");
+  poly_t *poly = poly_create(POLY_ICOSAHEDRON, 8);
+  const char *ply = "/tmp/3dm_test.ply", *gltf = "/tmp/3dm_test.gltf", *bin = "/tmp/3dm_test.bin";
+  long bytes = (poly->v_len + poly->t_len + poly->i_len) * 4L;
+
+  struct timespec t0, t1, t2;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  assert(poly_export_ply(poly, ply));
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  assert(poly_export_gltf(poly, gltf, bin));
+  clock_gettime(CLOCK_MONOTONIC, &t2);
+  double s0 = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+  double s1 = (t2.tv_sec - t1.tv_sec) + (t2.tv_nsec - t1.tv_nsec) / 1e9;
+  printf("BENCH: export %.1f MB, ply %.2f GB/s, gltf %.2f GB/s\n",
+      bytes / 1e6, file_size(ply) / s0 / 1e9, file_size(bin) / s1 / 1e9);
+
+  FILE *f = fopen(ply, "rb");
+  char line[128];
+  long header = 0;
+  while (fgets(line, sizeof(line), f) != NULL) {
+    header += strlen(line);
+    if (strcmp(line, "end_header\n") == 0) { break; }
+  }
+  float v[5];
+  assert(fread(v, sizeof(float), 5, f) == 5);
+  assert(memcmp(v, poly->vertices, 3 * sizeof(float)) == 0);
+  assert(memcmp(v + 3, poly->texcoords, 2 * sizeof(float)) == 0);
+  fclose(f);
+  assert(file_size(ply) == header + poly->v_len / 3 * 20L + poly->i_len / 3 * 13L);
+
+  assert(file_size(bin) == bytes);
+  f = fopen(bin, "rb");
+  char *data = malloc(bytes);
+  assert(fread(data, 1, bytes, f) == (size_t)bytes);
+  fclose(f);
+  assert(memcmp(data, poly->vertices, poly->v_len * 4L) == 0);
+  assert(memcmp(data + poly->v_len * 4L, poly->texcoords, poly->t_len * 4L) == 0);
+  assert(memcmp(data + (poly->v_len + poly->t_len) * 4L, poly->indices, poly->i_len * 4L) == 0);
+  free(data);
+
+  f = fopen(gltf, "r");
+  char json[4096];
+  json[fread(json, 1, sizeof(json) - 1, f)] = 0;
+  fclose(f);
+  assert(strstr(json, "\"uri\": \"3dm_test.bin\"") != NULL);
+
+  remove(ply);
+  remove(gltf);
+  remove(bin);
+  poly_destroy(poly);
+  test_end("test_poly_export");
+}
+
+void test_poly_subdivide()
+{
+  test_begin("test_poly_subdivide");
+  const enum poly_type types[3] = {POLY_ICOSAHEDRON, POLY_CUBE, POLY_CUBESPHERE};
+  for (int k = 0; k < 3; k++) {
+    poly_t *poly = poly_create(types[k], 3), *ref = poly_create(types[k], 5);
+    assert(!poly_subdivide(poly, -1));
+    assert(poly_subdivide(poly, 0) && poly->level == 3);
+    assert(poly_subdivide(poly, 2) && poly->level == 5);
+    assert(poly->i_len == ref->i_len);
+    assert(poly->t_len / 2 == poly->v_len / 3);
+    for (int i = 0; i < poly->i_len; i++) {
+      const float *a = poly->vertices + poly->indices[i] * 3, *b = ref->vertices + ref->indices[i] * 3;
+      assert(fabsf(a[0] - b[0]) < 1e-6 && fabsf(a[1] - b[1]) < 1e-6 && fabsf(a[2] - b[2]) < 1e-6);
+    }
+    for (int i = 0; i < poly->i_len; i += 3) {
+      float u0 = poly->texcoords[2 * poly->indices[i]];
+      float u1 = poly->texcoords[2 * poly->indices[i + 1]];
+      float u2 = poly->texcoords[2 * poly->indices[i + 2]];
+      assert(fabsf(u0 - u1) < 0.64 && fabsf(u1 - u2) < 0.64 && fabsf(u2 - u0) < 0.64);
+    }
+    poly_destroy(ref);
+    poly_destroy(poly);
+  }
+
+  poly_t *poly = poly_create(POLY_ICOSAHEDRON, 3);
+  assert(poly_subdivide(poly, 1));
+  int triangle = -1;
+  assert(poly_locate(poly, (float[]){0, 0, 1}, 1, &triangle));
+  assert(triangle >= 0 && triangle < poly->i_len / 3);
+  poly_destroy(poly);
+
+  // best of a few runs, single ones are noisy at this size
+  struct timespec t0, t1, t2;
+  double subdivide = INFINITY, create = INFINITY;
+  for (int r = 0; r < 5; r++) {
+    poly = poly_create(POLY_ICOSAHEDRON, 7);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    assert(poly_subdivide(poly, 1));
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    poly_t *ref = poly_create(POLY_ICOSAHEDRON, 8);
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+    for (int i = 0; r == 0 && i < poly->i_len; i += 3) {
+      float u0 = poly->texcoords[2 * poly->indices[i]];
+      float u1 = poly->texcoords[2 * poly->indices[i + 1]];
+      float u2 = poly->texcoords[2 * poly->indices[i + 2]];
+      assert(fabsf(u0 - u1) < 0.64 && fabsf(u1 - u2) < 0.64 && fabsf(u2 - u0) < 0.64);
+    }
+    subdivide = fmin(subdivide, ((t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9) * 1e3);
+    create = fmin(create, ((t2.tv_sec - t1.tv_sec) + (t2.tv_nsec - t1.tv_nsec) / 1e9) * 1e3);
+    poly_destroy(ref);
+    poly_destroy(poly);
+  }
+  printf("BENCH: icosahedron 7 -> 8, poly_subdivide %.2f ms, poly_create %.2f ms (%.0f%% saved)\n",
+         subdivide, create, 100 * (1 - subdivide / create));
+  test_end("test_poly_subdivide");
+}
+
+void test_array_columns()
+{
+  test_begin("test_array_columns");
+  const int count = 1000003;
+  mat4d *models = aligned_alloc(sizeof(mat4d), count * sizeof(mat4d));
+  float *buffer = aligned_alloc(64, (count + 1) * 16 * sizeof(float));
+  float *unaligned = buffer + 1;
+  for (int i = 0; i < count; i++) {
+    models[i] = mat4d_translate(mat4d_rotate(I, (vec4d)vector_new(0, 1, 1), i), i, -i, 1);
+  }
+
+  for (int k = 0; k < 4; k++) {
+    float *dst = k & 1 ? unaligned : buffer;
+    mat4d_to_mat4f_columns(dst, models, count, k & 2);
+    for (int i = 0; i < count; i += 13) {
+      mat4f f = mat4d_to_mat4f(mat4d_transpose(models[i]));
+      assert(memcmp(dst + 16 * i, f.ptr, sizeof(f.ptr)) == 0);
+    }
+  }
+
+  struct timespec t0, t1, t2, t3;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (int i = 0; i < count; i++) {
+    mat4f f = mat4d_to_mat4f(mat4d_transpose(models[i]));
+    memcpy(buffer + 16 * i, f.ptr, sizeof(f.ptr));
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  mat4d_to_mat4f_columns(unaligned, models, count, false);
+  clock_gettime(CLOCK_MONOTONIC, &t2);
+  mat4d_to_mat4f_columns(buffer, models, count, true);
+  clock_gettime(CLOCK_MONOTONIC, &t3);
+  double s0 = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+  double s1 = (t2.tv_sec - t1.tv_sec) + (t2.tv_nsec - t1.tv_nsec) / 1e9;
+  double s2 = (t3.tv_sec - t2.tv_sec) + (t3.tv_nsec - t2.tv_nsec) / 1e9;
+  printf("BENCH: transpose + to_mat4f %.2f M/s, columns %.2f M/s, columns streamed %.2f M/s\n",
+      count / s0 / 1e6, count / s1 / 1e6, count / s2 / 1e6);
+
+  free(models);
+  free(buffer);
+  test_end("test_array_columns");
+}
+
+void test_poly_lod()
+{
+  test_begin("test_poly_lod");
+  const enum poly_type types[3] = {POLY_ICOSAHEDRON, POLY_CUBE, POLY_CUBESPHERE};
+  const int n = 6;
+  assert(poly_lod_create(POLY_ICOSAHEDRON, -1) == NULL);
+  for (int k = 0; k < 3; k++) {
+    poly_lod_t *lod = poly_lod_create(types[k], n);
+    assert(lod != NULL && lod->levels == n + 1);
+    long chain = 0;
+    for (int level = 0; level <= n; level++) {
+      poly_t view = poly_lod_get(lod, level), *ref = poly_create(types[k], level);
+      assert(view.level == level && view.i_len == ref->i_len);
+      for (int i = 0; i < view.i_len; i++) {
+        assert(view.indices[i] >= 0 && view.indices[i] < view.v_len / 3);
+        const float *a = view.vertices + view.indices[i] * 3, *b = ref->vertices + ref->indices[i] * 3;
+        assert(fabsf(a[0] - b[0]) < 1e-6 && fabsf(a[1] - b[1]) < 1e-6 && fabsf(a[2] - b[2]) < 1e-6);
+      }
+      for (int i = 0; i < view.i_len; i++) {
+        // same texcoords as a single level, up to whole triangles moved by
+        // one u across the seam
+        float *a = view.texcoords + view.indices[i] * 2, *b = ref->texcoords + ref->indices[i] * 2;
+        float *a0 = view.texcoords + view.indices[i - i % 3] * 2, *b0 = ref->texcoords + ref->indices[i - i % 3] * 2;
+        float du = a[0] - b[0];
+        assert(fabsf(du - roundf(du)) < 1e-6 && fabsf(a[1] - b[1]) < 1e-6);
+        assert(roundf(du) == roundf(a0[0] - b0[0]));
+      }
+      chain += (ref->v_len + ref->t_len) * sizeof(float) + ref->i_len * sizeof(int);
+      poly_destroy(ref);
+    }
+    long shared = (lod->poly->v_len + lod->poly->t_len) * sizeof(float) + lod->poly->i_len * sizeof(int);
+    printf("BENCH: lod type %d levels 0-%d, shared %.2f MB, separate %.2f MB\n",
+        types[k], n, shared / 1048576.0, chain / 1048576.0);
+    assert(shared < chain);
+    poly_lod_destroy(lod);
+  }
+  test_end("test_poly_lod");
+}
+
+static void *cache_acquire_job(void *arg)
+{
+  *(const poly_t **)arg = poly_cache_acquire(POLY_ICOSAHEDRON, 7);
+  return NULL;
+}
+
+void test_poly_cache()
+{
+  test_begin("test_poly_cache");
+  const int threads = 8;
+  pthread_t tids[threads];
+  const poly_t *polys[threads];
+  poly_cache_stats_t s0 = poly_cache_stats();
+  for (int t = 0; t < threads; t++) {
+    assert(pthread_create(&tids[t], NULL, cache_acquire_job, &polys[t]) == 0);
+  }
+  for (int t = 0; t < threads; t++) {
+    pthread_join(tids[t], NULL);
+    assert(polys[t] != NULL && polys[t] == polys[0]);
+  }
+  poly_cache_stats_t s1 = poly_cache_stats();
+  assert(s1.misses - s0.misses == 1 && s1.hits - s0.hits == threads - 1);
+  assert(polys[0]->type == POLY_ICOSAHEDRON && polys[0]->level == 7);
+
+  struct timespec t0, t1;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  const poly_t *hit = poly_cache_acquire(POLY_ICOSAHEDRON, 7);
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  assert(hit == polys[0]);
+  printf("BENCH: poly_cache build %.2f ms, hit %.2f us, %ld waited\n", (s1.build_seconds - s0.build_seconds) * 1e3,
+      ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / 1e3, s1.waits - s0.waits);
+  poly_cache_release(hit);
+  for (int t = 0; t < threads; t++) {
+    poly_cache_release(polys[t]);
+  }
+  assert(poly_cache_acquire(POLY_CUBESPHERE, 14) == NULL);
+
+  // unreferenced meshes stay cached until the budget is exceeded
+  assert(poly_cache_stats().bytes > 0);
+  const poly_t *held = poly_cache_acquire(POLY_CUBE, 3);
+  poly_cache_budget(1);
+  poly_cache_stats_t s2 = poly_cache_stats();
+  assert(s2.evictions - s1.evictions == 1);
+  const poly_t *again = poly_cache_acquire(POLY_CUBE, 3);
+  assert(again == held && again->i_len > 0);
+  assert(poly_cache_release(again));
+  assert(poly_cache_release(held));
+  assert(!poly_cache_release(held));
+  assert(poly_cache_stats().bytes == 0);
+  poly_cache_budget(0);
+  const poly_t *cached = poly_cache_acquire(POLY_CUBESPHERE, 2);
+  assert(poly_cache_release(cached));
+  assert(!poly_cache_release(cached));
+  assert(poly_cache_stats().bytes > 0);
+  poly_cache_clear();
+  assert(poly_cache_stats().bytes == 0);
+  test_end("test_poly_cache");
+}
+
+void test_poly_skin()
+{
+  test_begin("test_poly_skin");
+  const int bones = 6;
+  poly_t *poly = poly_create(POLY_ICOSAHEDRON, 7);
+  poly_skin_t *skin = poly_skin_create(poly);
+  int len = skin->len;
+  mat4d palette[bones];
+  aff34f palette_f[bones];
+  for (int b = 0; b < bones; b++) {
+    palette[b] = mat4d_translate(mat4d_rotate(mat4d_scale(I, 2, 2, 2), (vec4d)vector_new(1, 0, 1), 10 * b), b, -b, 0.5);
+    palette_f[b] = aff34d_to_aff34f(aff34d_from_mat4d(palette[b]));
+  }
+  assert(!poly_skin_set(skin, len, (int[]){0, 0, 0, 0}, (float[]){1, 0, 0, 0}));
+  assert(!poly_skin_set(skin, 0, (int[]){-1, 0, 0, 0}, (float[]){1, 0, 0, 0}));
+  for (int i = 0; i < len; i++) {
+    const float *v = poly->vertices + i * 3;
+    float w[4] = {1 + v[0], 1 + v[1], 1 + v[2], i % 3 == 0 ? 0 : 1}, sum = w[0] + w[1] + w[2] + w[3];
+    for (int k = 0; k < 4; k++) { w[k] /= sum; }
+    assert(poly_skin_set(skin, i, (int[]){i % bones, (i + 1) % bones, (i + 2) % bones, i % 3 == 0 ? 99 : (i + 3) % bones}, w));
+  }
+  assert(skin->max_bone == bones - 1);
+  assert(!poly_skin_apply(skin, palette_f, bones - 1, poly->vertices, NULL, NULL, NULL, 1));
+
+  float *ref = malloc(poly->v_len * sizeof(float)), *out = malloc(poly->v_len * sizeof(float));
+  float *normals = malloc(poly->v_len * sizeof(float));
+  struct timespec t0, t1, t2, t3;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (int i = 0; i < len; i++) {
+    const float *v = poly->vertices + i * 3;
+    vec4d p = vector_new(v[0], v[1], v[2], 1), r = vector_new(0);
+    for (int k = 0; k < 4; k++) {
+      float w = skin->weights[i * 4 + k];
+      if (w != 0) {
+        r = vector_add(r, vector_scale(mat4d_multiply_vec4d(palette[skin->bones[i * 4 + k]], p), w));
+      }
+    }
+    ref[i * 3] = r.ptr[0]; ref[i * 3 + 1] = r.ptr[1]; ref[i * 3 + 2] = r.ptr[2];
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  assert(poly_skin_apply(skin, palette_f, bones, poly->vertices, NULL, out, NULL, 1));
+  clock_gettime(CLOCK_MONOTONIC, &t2);
+  for (int i = 0; i < poly->v_len; i++) {
+    assert(fabsf(out[i] - ref[i]) < 1e-4 * (1 + fabsf(ref[i])));
+  }
+  // positions on the unit sphere are their own normals
+  assert(poly_skin_apply(skin, palette_f, bones, poly->vertices, poly->vertices, out, normals, 4));
+  clock_gettime(CLOCK_MONOTONIC, &t3);
+  for (int i = 0; i < len; i += 5) {
+    float *n = normals + i * 3;
+    assert(fabsf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2] - 1) < 1e-5);
+    assert(fabsf(out[i * 3] - ref[i * 3]) < 1e-4 * (1 + fabsf(ref[i * 3])));
+  }
+  double s0 = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+  double s1 = (t2.tv_sec - t1.tv_sec) + (t2.tv_nsec - t1.tv_nsec) / 1e9;
+  double s2 = (t3.tv_sec - t2.tv_sec) + (t3.tv_nsec - t2.tv_nsec) / 1e9;
+  printf("BENCH: skinning %d vertices, mat4d_multiply_vec4d %.2f Mvertices/s, poly_skin_apply %.2f Mvertices/s, "
+      "4 threads with normals %.2f Mvertices/s\n", len, len / s0 / 1e6, len / s1 / 1e6, len / s2 / 1e6);
+
+  free(ref);
+  free(out);
+  free(normals);
+  poly_skin_destroy(skin);
+  poly_destroy(poly);
+  test_end("test_poly_skin");
+}
+
+void test_occlusion()
+{
+  test_begin("test_occlusion");
+  const int width = 384, height = 256;
+  mat4d vp = mat4d_multiply(mat4d_perspective(60, 1.5, 0.1, 100),
+      mat4d_look_at((vec4d)vector_new(0), (vec4d)vector_new(0, 0, -1), (vec4d)vector_new(0, 1)));
+  occlusion_t *o = occlusion_create(width, height);
+  assert(occlusion_create(0, 1) == NULL);
+
+  // a sphere of radius 5 at z = -20 in world space, so a bvh can check it
+  poly_t *poly = poly_create(POLY_ICOSAHEDRON, 4);
+  for (int i = 0; i < poly->v_len; i += 3) {
+    poly->vertices[i] *= 5; poly->vertices[i + 1] *= 5; poly->vertices[i + 2] = poly->vertices[i + 2] * 5 - 20;
+  }
+  assert(occlusion_rasterize(o, poly, vp, 3));
+  bool visible[6];
+  const float boxes[36] = {
+    -0.5, -0.5, -40.5, 0.5, 0.5, -39.5, // behind the sphere
+    -0.5, -0.5, -10.5, 0.5, 0.5, -9.5, // in front of it
+    19.5, -0.5, -40.5, 20.5, 0.5, -39.5, // beside it
+    -30, -30, -41, 30, 30, -39, // larger than its silhouette
+    -0.5, -0.5, 9.5, 0.5, 0.5, 10.5, // behind the camera
+    -1, -1, -30, 1, 1, 1, // through the near plane
+  };
+  assert(occlusion_test_boxes(o, vp, boxes, 6, visible) == 4);
+  assert(!visible[0] && visible[1] && visible[2] && visible[3] && !visible[4] && visible[5]);
+
+  // every hidden box center must be behind the sphere
+  const int count = 100000;
+  float *random = malloc(count * 6 * sizeof(float));
+  bool *results = malloc(count * sizeof(bool));
+  unsigned int seed = 1;
+  for (int i = 0; i < count * 6; i += 6) {
+    float c[3], e;
+    for (int k = 0; k < 3; k++) {
+      seed = seed * 1103515245 + 12345;
+      c[k] = (seed >> 8) / (float)(1 << 24);
+    }
+    seed = seed * 1103515245 + 12345;
+    e = 0.5 + (seed >> 8) / (float)(1 << 24);
+    c[0] = c[0] * 40 - 20; c[1] = c[1] * 30 - 15; c[2] = -25 - c[2] * 50;
+    for (int k = 0; k < 3; k++) {
+      random[i + k] = c[k] - e;
+      random[i + 3 + k] = c[k] + e;
+    }
+  }
+  struct timespec t0, t1, t2;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  int n_visible = occlusion_test_boxes(o, vp, random, count, results);
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  bvh_t *bvh = bvh_create(poly);
+  int hidden = 0;
+  for (int i = 0; i < count; i++) {
+    if (results[i]) {
+      continue;
+    }
+    const float *b = random + i * 6;
+    vec4f c = vector_new((b[0] + b[3]) / 2, (b[1] + b[4]) / 2, (b[2] + b[5]) / 2);
+    ray_t ray = { vector_new(0, 0, 0), c };
+    ray_hit_t hit;
+    assert(bvh_intersect(bvh, ray, &hit) && hit.t < 1);
+    hidden++;
+  }
+  assert(hidden > 0 && hidden == count - n_visible);
+  printf("BENCH: occlusion %d boxes, %.1f%% culled, %.2f Mboxes/s\n", count, 100.0 * hidden / count,
+      count / ((t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9) / 1e6);
+  bvh_destroy(bvh);
+  poly_destroy(poly);
+
+  // a frame of 16 occluding spheres
+  poly = poly_create(POLY_ICOSAHEDRON, 4);
+  const int frames = 20;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (int f = 0; f < frames; f++) {
+    occlusion_clear(o);
+    for (int s = 0; s < 16; s++) {
+      mat4d model = mat4d_multiply(mat4d_translate(I, (s % 4) * 10 - 15, (s / 4) * 7 - 10.5, -30), mat4d_scale(I, 4, 4, 4));
+      occlusion_rasterize(o, poly, mat4d_multiply(vp, model), 4);
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  n_visible = occlusion_test_boxes(o, vp, random, count, results);
+  clock_gettime(CLOCK_MONOTONIC, &t2);
+  printf("BENCH: occlusion frame of %d triangles, raster %.2f ms, queries %.2f ms, %.1f%% culled\n",
+      16 * poly->i_len / 3, ((t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9) * 1e3 / frames,
+      ((t2.tv_sec - t1.tv_sec) + (t2.tv_nsec - t1.tv_nsec) / 1e9) * 1e3, 100.0 * (count - n_visible) / count);
+
+  // the triangles are binned once, more bands shouldn't multiply the work
+  poly_destroy(poly);
+  poly = poly_create(POLY_ICOSAHEDRON, 6);
+  mat4d model = mat4d_multiply(vp, mat4d_multiply(mat4d_translate(I, 0, 0, -30), mat4d_scale(I, 10, 10, 10)));
+  double band_ms[2] = {INFINITY, INFINITY};
+  for (int r = 0; r < 10; r++) {
+    for (int k = 0; k < 2; k++) {
+      occlusion_clear(o);
+      clock_gettime(CLOCK_MONOTONIC, &t0);
+      assert(occlusion_rasterize(o, poly, model, k == 0 ? 1 : 4));
+      clock_gettime(CLOCK_MONOTONIC, &t1);
+      band_ms[k] = fmin(band_ms[k], ((t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9) * 1e3);
+    }
+  }
+  // bands only run side by side with more than one core online
+  printf("BENCH: occlusion %d triangles, 1 band %.2f ms, 4 bands %.2f ms, %ld cores\n",
+      poly->i_len / 3, band_ms[0], band_ms[1], sysconf(_SC_NPROCESSORS_ONLN));
+
+  free(random);
+  free(results);
+  poly_destroy(poly);
+  occlusion_destroy(o);
+  test_end("test_occlusion");
+}
+
+static void assert_corner_table(const corner_table_t *ct)
+{
+  for (int c = 0; c < ct->c_len; c++) {
+    int o = ct->opposites[c];
+    assert(ct->vertices[ct->corners[ct->vertices[c]]] == ct->vertices[c]);
+    if (o >= 0) {
+      assert(ct->opposites[o] == c);
+      assert(ct->vertices[corner_next(c)] == ct->vertices[corner_prev(o)]);
+      assert(ct->vertices[corner_prev(c)] == ct->vertices[corner_next(o)]);
+    }
+  }
+}
+
+void test_corner_table()
+{
+  test_begin("test_corner_table");
+  int ring[16];
+  poly_t *poly = poly_create(POLY_ICOSAHEDRON, 0);
+  corner_table_t *ct = corner_table_create(poly);
+  assert(ct->c_len == 60 && ct->v_len == 12);
+  assert_corner_table(ct);
+  for (int c = 0; c < ct->c_len; c++) {
+    assert(ct->opposites[c] >= 0);
+    assert(corner_table_ring(ct, c, ring, 16) == 5);
+  }
+
+  const int level = 4;
+  poly_t *ref = poly_create(POLY_ICOSAHEDRON, level);
+  corner_table_t *built = corner_table_create(ref);
+  assert(corner_table_subdivide(ct, level) && poly_subdivide(poly, level));
+  assert_corner_table(ct);
+  assert(ct->c_len == built->c_len && ct->v_len == built->v_len && ct->v_len == 10 * (1 << 2 * level) + 2);
+  int *map = malloc(ct->v_len * sizeof(int));
+  memset(map, -1, ct->v_len * sizeof(int));
+  int seams = 0, valence5 = 0;
+  for (int c = 0; c < ct->c_len; c++) {
+    assert(ct->opposites[c] == built->opposites[c]);
+    int v = ct->vertices[c];
+    assert(map[v] < 0 || map[v] == built->vertices[c]);
+    map[v] = built->vertices[c];
+    int n = corner_table_ring(ct, c, ring, 16);
+    assert(n == 5 || n == 6);
+    valence5 += n == 5;
+    bool seam = corner_table_seam(ct, poly, c);
+    assert(seam == corner_table_seam(ct, poly, ct->opposites[c]));
+    assert(seam == corner_table_seam(built, ref, c));
+    seams += seam;
+  }
+  assert(valence5 == 12 * 5);
+  assert(seams > 0 && seams < ct->c_len / 10);
+  free(map);
+  corner_table_destroy(built);
+  corner_table_destroy(ct);
+  poly_destroy(ref);
+  poly_destroy(poly);
+
+  poly = poly_create(POLY_CUBE, 2);
+  ct = corner_table_create(poly);
+  assert_corner_table(ct);
+  assert(!corner_table_subdivide(ct, 1));
+  corner_table_destroy(ct);
+  poly_destroy(poly);
+
+  struct timespec t0, t1, t2;
+  poly = poly_create(POLY_ICOSAHEDRON, 7);
+  ct = corner_table_create(poly);
+  assert(poly_subdivide(poly, 1));
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  built = corner_table_create(poly);
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  assert(corner_table_subdivide(ct, 1));
+  clock_gettime(CLOCK_MONOTONIC, &t2);
+  assert(memcmp(ct->opposites, built->opposites, ct->c_len * sizeof(int)) == 0);
+  double s0 = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+  double s1 = (t2.tv_sec - t1.tv_sec) + (t2.tv_nsec - t1.tv_nsec) / 1e9;
+  printf("BENCH: corner table level 8, %d corners, create %.2f ms (%.1f Mcorners/s), subdivide from 7 %.2f ms (%.1f Mcorners/s)\n",
+      ct->c_len, s0 * 1e3, ct->c_len / s0 / 1e6, s1 * 1e3, ct->c_len / s1 / 1e6);
+  corner_table_destroy(built);
+  corner_table_destroy(ct);
+  poly_destroy(poly);
+  test_end("test_corner_table");
+}
+
+static int triangle_compare(const void *a, const void *b)
+{
+  return memcmp(a, b, 3 * sizeof(int));
+}
+
+void test_meshlets()
+{
+  test_begin("test_meshlets");
+  const int max_v = 64, max_t = 124;
+  poly_t *poly = poly_create(POLY_ICOSAHEDRON, 6);
+  int t_len = poly->i_len / 3;
+  assert(meshlets_create(poly, 257, max_t) == NULL);
+  meshlets_t *m = meshlets_create(poly, max_v, max_t);
+  assert(m != NULL && m->t_len == poly->i_len);
+
+  // the same triangles, each in one meshlet, within bounds
+  int *tris = malloc(t_len * 4 * sizeof(int)), *ref = malloc(poly->i_len * sizeof(int));
+  int n = 0;
+  for (int i = 0; i < m->m_len; i++) {
+    const meshlet_t *ml = m->meshlets + i;
+    assert(ml->v_count <= max_v && ml->t_count <= max_t && ml->t_count > 0);
+    for (int t = 0; t < ml->t_count; t++, n++) {
+      for (int k = 0; k < 3; k++) {
+        int l = m->triangles[(ml->t_offset + t) * 3 + k];
+        assert(l < ml->v_count);
+        tris[n * 4 + k] = m->vertices[ml->v_offset + l];
+      }
+      tris[n * 4 + 3] = i;
+    }
+    for (int v = 0; v < ml->v_count; v++) {
+      const float *p = poly->vertices + m->vertices[ml->v_offset + v] * 3;
+      float d[3] = {p[0] - ml->center[0], p[1] - ml->center[1], p[2] - ml->center[2]};
+      assert(sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]) <= ml->radius * (1 + 1e-5));
+    }
+    assert(ml->cone_cutoff <= 1);
+  }
+  assert(n == t_len);
+  memcpy(ref, poly->indices, poly->i_len * sizeof(int));
+  qsort(tris, t_len, 4 * sizeof(int), triangle_compare);
+  qsort(ref, t_len, 3 * sizeof(int), triangle_compare);
+  for (int t = 0; t < t_len; t++) {
+    assert(triangle_compare(tris + t * 4, ref + t * 3) == 0);
+  }
+
+  // every front facing triangle in the view is in a visible meshlet
+  vec4d eye = vector_new(0.3, 0.4, 1.6);
+  mat4d vp = mat4d_multiply(mat4d_perspective(60, 1.5, 0.1, 100),
+      mat4d_look_at(eye, (vec4d)vector_new(0), (vec4d)vector_new(0, 1)));
+  int *visible = malloc(m->m_len * sizeof(int));
+  bool *shown = calloc(m->m_len, sizeof(bool));
+  int n_visible = meshlets_cull(m, vp, visible);
+  for (int i = 0; i < n_visible; i++) {
+    shown[visible[i]] = true;
+  }
+  int front = 0, visible_t = 0;
+  for (int t = 0; t < t_len; t++) {
+    const int *tri = tris + t * 4;
+    vec4d v[3], c = vector_new(0, 0, 0, 1);
+    for (int k = 0; k < 3; k++) {
+      const float *p = poly->vertices + tri[k] * 3;
+      v[k] = (vec4d)vector_new(p[0], p[1], p[2]);
+      c = vector_add(c, vector_scale(v[k], 1.0 / 3));
+    }
+    vec4d normal = vec4d_cross_product(vector_add(v[1], vector_scale(v[0], -1)), vector_add(v[2], vector_scale(v[0], -1)));
+    vec4d clip = mat4d_multiply_vec4d(vp, c);
+    bool in_view = fabs(clip.ptr[0]) < clip.ptr[3] && fabs(clip.ptr[1]) < clip.ptr[3] && fabs(clip.ptr[2]) < clip.ptr[3];
+    if (in_view && vec4d_dot_product(normal, vector_add(c, vector_scale(eye, -1))) < 0) {
+      assert(shown[tri[3]]);
+      front++;
+    }
+    visible_t += shown[tri[3]];
+  }
+  assert(front > 0 && visible_t < t_len / 2);
+
+  // from far away an ortho view culls the back half
+  vp = mat4d_multiply(mat4d_frustum_ortho(-1.5, 1.5, -1.5, 1.5, 0.1, 100),
+      mat4d_look_at((vec4d)vector_new(0, 0, 10), (vec4d)vector_new(0), (vec4d)vector_new(0, 1)));
+  n = meshlets_cull(m, vp, visible);
+  assert(n > m->m_len / 4 && n < m->m_len * 3 / 4);
+  for (int i = 0; i < n; i++) {
+    assert(m->meshlets[visible[i]].center[2] > -0.2);
+  }
+  printf("BENCH: meshlets %d of %d triangles, %.1f triangles each, %.1f%% of the triangles drawn up close\n",
+      m->m_len, t_len, (double)t_len / m->m_len, 100.0 * visible_t / t_len);
+  free(tris);
+  free(ref);
+  free(visible);
+  free(shown);
+  meshlets_destroy(m);
+  poly_destroy(poly);
+
+  struct timespec t0, t1, t2;
+  poly = poly_create(POLY_ICOSAHEDRON, 8);
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  m = meshlets_create(poly, max_v, max_t);
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  visible = malloc(m->m_len * sizeof(int));
+  vp = mat4d_multiply(mat4d_perspective(60, 1.5, 0.01, 100),
+      mat4d_look_at((vec4d)vector_new(0, 0, 1.1), (vec4d)vector_new(0), (vec4d)vector_new(0, 1)));
+  const int frames = 100;
+  for (int f = 0; f < frames; f++) {
+    n = meshlets_cull(m, vp, visible);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t2);
+  visible_t = 0;
+  for (int i = 0; i < n; i++) {
+    visible_t += m->meshlets[visible[i]].t_count;
+  }
+  printf("BENCH: meshlets level 8, create %.2f ms, cull %d meshlets %.3f ms, %d of %d triangles kept\n",
+      ((t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9) * 1e3, m->m_len,
+      ((t2.tv_sec - t1.tv_sec) + (t2.tv_nsec - t1.tv_nsec) / 1e9) * 1e3 / frames, visible_t, poly->i_len / 3);
+  free(visible);
+  meshlets_destroy(m);
+  poly_destroy(poly);
+  test_end("test_meshlets");
+}
+
 int main(int argc, const char *argv[])
 {
   test_vector();
@@ -296,5 +1460,21 @@ int main(int argc, const char *argv[])
   test_mat4();
   test_poly_icosahedron();
   test_poly_cube();
+  test_poly_cubesphere();
+  test_bvh();
+  test_poly_locate();
+  test_array();
+  test_array_columns();
+  test_precision();
+  test_affine();
+  test_poly_adaptive();
+  test_poly_export();
+  test_poly_subdivide();
+  test_poly_lod();
+  test_poly_cache();
+  test_poly_skin();
+  test_occlusion();
+  test_corner_table();
+  test_meshlets();
   return 0;
 }
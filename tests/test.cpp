@@ -0,0 +1,50 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <cassert>
+#include "3dm/3dm.hpp"
+
+using namespace m3d;
+
+constexpr auto TS = translate(1, 2, 3) * scale(1, 2, 3);
+static_assert(decltype(TS)::mask == MASK_TRANSLATE, "translate * scale keeps the translate pattern");
+static_assert(TS(0, 0) == 1 && TS(1, 1) == 2 && TS(2, 2) == 3 && TS(3, 3) == 1, "scale");
+static_assert(TS(0, 3) == 1 && TS(1, 3) == 2 && TS(2, 3) == 3, "translate");
+static_assert((identity() * vec4(1, 2, 3, 1))[2] == 3, "identity");
+static_assert((TS * vec4(1, 1, 1, 1))[1] == 4, "transform point");
+static_assert((TS * vec4(1, 1, 1, 0))[1] == 2, "transform direction");
+static_assert(decltype(TS * rotate(vec4(0, 0, 1), 10))::mask == MASK_AFFINE, "affine chain");
+static_assert(decltype(perspective(60, 1, 1, 10) * TS)::mask == MASK_DENSE, "dense");
+
+static void assert_near(mat4d m, mat4d n, double e)
+{
+  for (int i = 0; i < 16; i++) {
+    if (std::fabs(m.ptr[i] - n.ptr[i]) > e) {
+      fprintf(stderr, "assert_near: %d %f %f\n", i, m.ptr[i], n.ptr[i]);
+      abort();
+    }
+  }
+}
+
+int main(int argc, const char *argv[])
+{
+  printf("TEST BEGIN: test_cxx\n");
+  mat4d m = vector_new(1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16);
+  vec4d axis = vector_new(0, 1, 1);
+
+  mat4 r = translate(1, 2, 3) * scale(1, 2, 3) * rotate(axis, 30) * mat4(m);
+  assert_near(r, mat4d_translate(mat4d_scale(mat4d_rotate(m, axis, 30), 1, 2, 3), 1, 2, 3), 1e-12);
+
+  mat4d vp = mat4d_multiply(mat4d_perspective(60, 1.5, 0.1, 100),
+      mat4d_look_at((vec4d)vector_new(1, 2, 3), (vec4d)vector_new(0), (vec4d)vector_new(0, 1)));
+  mat4 mvp = perspective(60, 1.5, 0.1, 100) * look_at(vec4(1, 2, 3), vec4(), vec4(0, 1, 0)) * TS;
+  assert_near(mvp, mat4d_multiply(vp, TS), 1e-12);
+
+  vec4 p = mvp * vec4(1, 2, 3, 1);
+  vec4d q = mat4d_multiply_vec4d(mvp, (vec4d)vector_new(1, 2, 3, 1));
+  for (int i = 0; i < 4; i++) {
+    assert(std::fabs(p[i] - q.ptr[i]) < 1e-12);
+  }
+  printf("TEST END: test_cxx\n");
+  return 0;
+}